@@ -0,0 +1,45 @@
+#include "csapp.h"
+#include "bufpool.h"
+#include "slab.h"
+
+/* Take an empty full-size chunk from the slab allocator */
+buf_chunk_t *bufpool_get(void) {
+    buf_chunk_t *chunk = slab_alloc(sizeof(buf_chunk_t) + BUFPOOL_CHUNK_SIZE);
+    chunk->next = NULL;
+    chunk->len = 0;
+    chunk->cap = BUFPOOL_CHUNK_SIZE;
+    return chunk;
+}
+
+/*
+ * bufpool_trim - Move a partly used chunk into the smallest size class
+ *     that holds its bytes, so the last chunk of a body does not pin a
+ *     whole 8 KB item. Returns the chunk to use in its place.
+ */
+buf_chunk_t *bufpool_trim(buf_chunk_t *chunk) {
+    buf_chunk_t *small = slab_alloc(sizeof(buf_chunk_t) + chunk->len);
+
+    if (slab_item_size(small) >= slab_item_size(chunk)) {
+        slab_free(small); // 더 작은 클래스가 없으면 그대로 사용
+        return chunk;
+    }
+    small->next = chunk->next;
+    small->len = small->cap = chunk->len;
+    memcpy(small->data, chunk->data, chunk->len);
+    slab_free(chunk);
+    return small;
+}
+
+/* Return one chunk to its slab class */
+void bufpool_put(buf_chunk_t *chunk) {
+    slab_free(chunk);
+}
+
+/* Return a whole chain of chunks */
+void bufpool_put_chain(buf_chunk_t *head) {
+    while (head != NULL) {
+        buf_chunk_t *next = head->next;
+        bufpool_put(head);
+        head = next;
+    }
+}
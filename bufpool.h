@@ -0,0 +1,21 @@
+/*
+ * bufpool.h - chunk chains used to buffer cache fills and hold bodies
+ */
+#ifndef __BUFPOOL_H__
+#define __BUFPOOL_H__
+
+#define BUFPOOL_CHUNK_SIZE 8192 /* Payload bytes of a full fill chunk */
+
+typedef struct buf_chunk {
+    struct buf_chunk *next;     /* Next chunk of the same object */
+    int len;                    /* Bytes used in data */
+    int cap;                    /* Bytes available in data */
+    char data[];
+} buf_chunk_t;
+
+buf_chunk_t *bufpool_get(void);
+buf_chunk_t *bufpool_trim(buf_chunk_t *chunk);
+void bufpool_put(buf_chunk_t *chunk);
+void bufpool_put_chain(buf_chunk_t *head);
+
+#endif /* __BUFPOOL_H__ */
@@ -0,0 +1,1238 @@
+#include "csapp.h"
+#include "cache.h"
+#include "epoch.h"
+#include "slab.h"
+#include "sketch.h"
+#include "policy.h"
+#include "disk.h"
+#include "snapshot.h"
+#include "dedup.h"
+#include "vary.h"
+#include "mem.h"
+
+cache_t cache;
+
+/* 64-bit FNV-1a hash of a URI, used as the cache index key */
+unsigned long cache_hash(const char *uri) {
+    unsigned long h = 14695981039346656037UL;
+    while (*uri) {
+        h ^= (unsigned char)*uri++;
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+/* Memory taken by an index with nbuckets buckets, charged to its shard */
+static long index_bytes(int nbuckets) {
+    return sizeof(cache_index_t) + nbuckets * sizeof(cache_entry_t *);
+}
+
+/* Allocate an empty index with nbuckets buckets */
+static cache_index_t *index_alloc(int nbuckets) {
+    cache_index_t *idx = calloc(1, sizeof(cache_index_t) + nbuckets * sizeof(cache_entry_t *));
+    if (idx != NULL) {
+        idx->nbuckets = nbuckets;
+        mem_overhead_charge(index_bytes(nbuckets)); // 힙에 있으므로 slab 페이지와 따로 센다
+    }
+    return idx;
+}
+
+/* Initialise one shard with an empty index and its share of the byte budget */
+static void shard_init(cache_shard_t *sh, long max_size) {
+    memset(sh->lists, 0, sizeof(sh->lists));
+    sh->win_max = cache.admission ? max_size * CACHE_WINDOW_PERCENT / 100 : 0;
+    if (cache.admission) {
+        sketch_init(&sh->sketch, MAX(max_size / CACHE_AVG_OBJECT_SIZE, 1));
+    }
+    sh->index = index_alloc(CACHE_MIN_BUCKETS);
+    purge_index_init(&sh->purge);
+    if (sh->index == NULL) {
+        fprintf(stderr, "캐시 인덱스 메모리 할당 실패\n");
+        exit(1);
+    }
+    sh->nentries = 0;
+    // 인덱스와 sketch도 캐시가 쓰는 메모리이므로 처음부터 예산에 포함
+    sh->total_size = index_bytes(CACHE_MIN_BUCKETS);
+    if (cache.admission) {
+        sh->total_size += SKETCH_DEPTH * sh->sketch.width + sh->sketch.width / 4;
+        mem_overhead_charge(SKETCH_DEPTH * sh->sketch.width + sh->sketch.width / 4);
+    }
+    sh->max_size = max_size;
+    sh->hits = sh->misses = sh->evictions = sh->rejections = sh->expirations = sh->revalidations = 0;
+    sh->purges = 0;
+    sh->purge_gen = 1; // fill의 gen 0은 "확인하지 않음"
+    cache.policy->init(sh); // 정책별 리스트와 ghost 준비
+    if (sem_init(&sh->sem, 0, 1) != 0) { // 세마포어 초기화
+        perror("sem_init failed");
+        exit(1);
+    }
+}
+
+static void *cache_sweeper(void *vargp);
+
+/* Split the cache into cfg->nshards independent shards and start the expiry sweeper */
+void cache_init(const cache_config_t *cfg) {
+    int nshards = MAX(cfg->nshards, 1);
+    pthread_t tid;
+
+    cache.nshards = nshards;
+    cache.admission = cfg->admission;
+    cache.default_ttl = cfg->default_ttl;
+    cache.negative_ttl = cfg->negative_ttl;
+    cache.error_ttl = cfg->error_ttl;
+    cache.policy = policy_find(cfg->policy != NULL ? cfg->policy : CACHE_DEFAULT_POLICY);
+    if (cache.policy == NULL) {
+        app_error("cache: unknown eviction policy");
+    }
+    cache.shards = Calloc(nshards, sizeof(cache_shard_t));
+    for (int i = 0; i < nshards; i++) {
+        shard_init(&cache.shards[i], cfg->max_size / nshards);
+    }
+    epoch_init();
+    dedup_init();
+    // 가장 큰 항목: 최대 길이 URI를 가진 entry 또는 꽉 찬 body chunk
+    slab_init(MAX(sizeof(cache_entry_t) + MAXLINE, sizeof(buf_chunk_t) + BUFPOOL_CHUNK_SIZE));
+    Pthread_create(&tid, NULL, cache_sweeper, NULL);
+}
+
+/* Pick the shard for a URI hash. The high bits are used so the shard
+   choice stays independent of the bucket index inside the shard. */
+static cache_shard_t *shard_for(unsigned long hash) {
+    return &cache.shards[(hash >> 32) % cache.nshards];
+}
+
+/*
+ * index_find - Find the entry for uri in idx. Safe without the shard lock as
+ *     long as the caller is inside an epoch: entries are fully built
+ *     before they are linked, and unlinked entries keep their hnext until
+ *     the grace period ends. A concurrent index_grow() may make a reader
+ *     miss an entry that is present, which only costs an origin fetch.
+ */
+static cache_entry_t *index_find(cache_index_t *idx, const char *uri, unsigned long hash) {
+    cache_entry_t *e = __atomic_load_n(&idx->buckets[hash & (idx->nbuckets - 1)], __ATOMIC_ACQUIRE);
+    while (e != NULL) {
+        if (e->hash == hash && strcmp(e->uri, uri) == 0) {
+            return e;
+        }
+        e = __atomic_load_n(&e->hnext, __ATOMIC_ACQUIRE);
+    }
+    return NULL;
+}
+
+/* Link entry at the head of its bucket; caller holds the shard's sem */
+static void index_link(cache_index_t *idx, cache_entry_t *entry) {
+    cache_entry_t **bucket = &idx->buckets[entry->hash & (idx->nbuckets - 1)];
+    __atomic_store_n(&entry->hnext, *bucket, __ATOMIC_RELAXED);
+    __atomic_store_n(bucket, entry, __ATOMIC_RELEASE); /* Publish after entry is built */
+}
+
+/* Double the bucket array and rehash every entry; caller holds sh->sem */
+static void index_grow(cache_shard_t *sh) {
+    cache_index_t *old = sh->index;
+    cache_index_t *idx = index_alloc(old->nbuckets * 2);
+    if (idx == NULL) {
+        return; // 확장 실패 시 기존 인덱스를 그대로 사용
+    }
+    for (int i = 0; i < old->nbuckets; i++) {
+        cache_entry_t *e = old->buckets[i];
+        while (e != NULL) {
+            cache_entry_t *hnext = e->hnext;
+            index_link(idx, e);
+            e = hnext;
+        }
+    }
+    __atomic_store_n(&sh->index, idx, __ATOMIC_RELEASE);
+    sh->total_size += index_bytes(idx->nbuckets) - index_bytes(old->nbuckets);
+    mem_overhead_charge(-index_bytes(old->nbuckets));
+    epoch_retire(&old->retire, old, free);
+}
+
+/* Unlink entry from its hash bucket; caller holds sh->sem */
+static void index_remove(cache_shard_t *sh, cache_entry_t *entry) {
+    cache_index_t *idx = sh->index;
+    cache_entry_t **pp = &idx->buckets[entry->hash & (idx->nbuckets - 1)];
+    while (*pp != NULL) {
+        if (*pp == entry) {
+            // entry->hnext는 그대로 두어 순회 중인 reader가 계속 진행할 수 있게 한다
+            __atomic_store_n(pp, entry->hnext, __ATOMIC_RELEASE);
+            return;
+        }
+        pp = &(*pp)->hnext;
+    }
+}
+
+/* Has entry outlived its freshness lifetime? */
+static int entry_expired(cache_entry_t *entry, long now) {
+    return entry->expires != 0 && entry->expires <= now;
+}
+
+/* May entry still be served, fresh or within its stale-while-revalidate window? */
+static int entry_servable(cache_entry_t *entry, long now) {
+    return !entry_expired(entry, now) || now < entry->stale_until;
+}
+
+/* When the sweeper should look at entry again */
+static long entry_deadline(cache_entry_t *entry) {
+    return MAX(entry->expires, entry->stale_until);
+}
+
+/*
+ * cache_lookup - Look up uri without taking any lock. A hit returns
+ *     the entry pinned: it stays valid, even after eviction, until the
+ *     caller drops its reference with cache_release(). Returns NULL on a
+ *     miss; an expired entry counts as a miss and is left to the sweeper,
+ *     unless it may still be served while stale (see cache_claim_refresh()).
+ */
+cache_entry_t *cache_lookup(const char *uri, unsigned long hash) {
+    cache_shard_t *sh = shard_for(hash);
+
+    if (cache.admission) {
+        sketch_increment(&sh->sketch, hash); // 히트와 미스 모두 빈도에 반영
+    }
+
+    epoch_enter();
+    cache_index_t *idx = __atomic_load_n(&sh->index, __ATOMIC_ACQUIRE);
+    cache_entry_t *entry = index_find(idx, uri, hash);
+    if (entry != NULL && !entry_servable(entry, time(NULL))) {
+        entry = NULL; // 만료된 항목은 서비스하지 않는다 (회수는 sweeper 몫)
+    }
+    if (entry != NULL) {
+        // epoch 안에서는 캐시 자신의 참조가 아직 남아 있으므로 바로 증가해도 안전
+        __atomic_fetch_add(&entry->refcnt, 1, __ATOMIC_ACQUIRE);
+    }
+    epoch_exit();
+
+    if (entry == NULL) {
+        __atomic_fetch_add(&sh->misses, 1, __ATOMIC_RELAXED);
+        return NULL; // 캐시 미스
+    }
+    __atomic_fetch_add(&sh->hits, 1, __ATOMIC_RELAXED);
+    if (!cache.policy->hit_locks) {
+        cache.policy->on_hit(sh, entry);
+    } else if (sem_trywait(&sh->sem) == 0) {
+        // 리스트를 옮기는 정책은 잠금이 비어 있을 때만 히트를 반영 (reader는 기다리지 않는다)
+        cache.policy->on_hit(sh, entry);
+        sem_post(&sh->sem);
+    }
+    return entry; // 캐시 히트
+}
+
+/*
+ * cache_lookup_stale - Pin uri even if it has expired, as long as it
+ *     carries validators the origin can check. The caller revalidates
+ *     it and drops the reference with cache_release(). Not counted as
+ *     a hit or a miss.
+ */
+cache_entry_t *cache_lookup_stale(const char *uri, unsigned long hash) {
+    cache_shard_t *sh = shard_for(hash);
+
+    epoch_enter();
+    cache_entry_t *entry = index_find(__atomic_load_n(&sh->index, __ATOMIC_ACQUIRE), uri, hash);
+    if (entry != NULL && !entry->revalidate) {
+        entry = NULL;
+    }
+    if (entry != NULL) {
+        __atomic_fetch_add(&entry->refcnt, 1, __ATOMIC_ACQUIRE);
+    }
+    epoch_exit();
+    return entry;
+}
+
+/*
+ * cache_claim_refresh - Is the pinned entry being served stale, with no
+ *     refresh under way yet? Returns 1 to exactly one caller, which must
+ *     queue the refresh (refresh_request()).
+ */
+int cache_claim_refresh(cache_entry_t *entry) {
+    if (!entry_expired(entry, time(NULL)) || __atomic_load_n(&entry->refreshing, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    return __atomic_exchange_n(&entry->refreshing, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+/* Drop one reference to entry; the last one frees it */
+void cache_release(cache_entry_t *entry) {
+    if (__atomic_sub_fetch(&entry->refcnt, 1, __ATOMIC_ACQ_REL) == 0) {
+        if (entry->mapped != NULL) {
+            snapshot_unref(); // 스냅샷 매핑을 쓰던 마지막 항목이면 매핑 해제
+        }
+        if (entry->blob != NULL) {
+            dedup_detach(entry->chunks, entry->blob, entry->blob_owner);
+        } else {
+            bufpool_put_chain(entry->chunks);
+        }
+        slab_free(entry);
+    }
+}
+
+/* Write a pinned entry to fd chunk by chunk; returns -1 if the client went away */
+int cache_write(int fd, cache_entry_t *entry) {
+    if (entry->mapped != NULL) {
+        return rio_writen(fd, (void *)entry->mapped, entry->content_length) < 0 ? -1 : 0;
+    }
+    for (buf_chunk_t *c = entry->chunks; c != NULL; c = c->next) {
+        if (rio_writen(fd, c->data, c->len) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Write len bytes of a pinned entry starting at off to fd; returns -1 if the client went away */
+int cache_write_range(int fd, cache_entry_t *entry, long off, long len) {
+    if (entry->mapped != NULL) {
+        return rio_writen(fd, (void *)(entry->mapped + off), len) < 0 ? -1 : 0;
+    }
+    for (buf_chunk_t *c = entry->chunks; c != NULL && len > 0; c = c->next) {
+        if (off >= c->len) {
+            off -= c->len;
+            continue;
+        }
+        long k = MIN(c->len - off, len);
+        if (rio_writen(fd, c->data + off, k) < 0) {
+            return -1;
+        }
+        len -= k;
+        off = 0;
+    }
+    return 0;
+}
+
+/* Copy up to n bytes of a pinned entry starting at off into buf; returns the count */
+int cache_read(cache_entry_t *entry, long off, char *buf, int n) {
+    int copied = 0;
+
+    if (entry->mapped != NULL) {
+        copied = MAX(MIN(n, entry->content_length - off), 0);
+        memcpy(buf, entry->mapped + off, copied);
+        return copied;
+    }
+    for (buf_chunk_t *c = entry->chunks; c != NULL && copied < n; c = c->next) {
+        if (off >= c->len) {
+            off -= c->len; // 시작 위치 이전의 chunk는 건너뛴다
+            continue;
+        }
+        int k = MIN(c->len - off, n - copied);
+        memcpy(buf + copied, c->data + off, k);
+        copied += k;
+        off = 0;
+    }
+    return copied;
+}
+
+void cache_fill_init(cache_fill_t *fill) {
+    fill->head = fill->tail = NULL;
+    fill->length = 0;
+    fill->oversized = 0;
+    fill->expires = -1;
+    fill->gen = 0;
+    fill->hdrs = NULL;
+}
+
+/* Append n response bytes to the fill unless it has already outgrown MAX_OBJECT_SIZE */
+void cache_fill_append(cache_fill_t *fill, const char *buf, int n) {
+    if (fill->oversized) {
+        return;
+    }
+    if (fill->length + n > MAX_OBJECT_SIZE) {
+        // 캐시할 수 없는 크기이므로 지금까지의 버퍼를 바로 반납
+        cache_fill_discard(fill);
+        fill->oversized = 1;
+        return;
+    }
+    fill->length += n;
+    while (n > 0) {
+        if (fill->tail == NULL || fill->tail->len == fill->tail->cap) {
+            buf_chunk_t *c = bufpool_get();
+            if (fill->tail == NULL) {
+                fill->head = c;
+            } else {
+                fill->tail->next = c;
+            }
+            fill->tail = c;
+        }
+        int k = MIN(n, fill->tail->cap - fill->tail->len);
+        memcpy(fill->tail->data + fill->tail->len, buf, k);
+        fill->tail->len += k;
+        buf += k;
+        n -= k;
+    }
+}
+
+/* Give a fill's chunks back to the pool without caching them */
+void cache_fill_discard(cache_fill_t *fill) {
+    bufpool_put_chain(fill->head);
+    fill->head = fill->tail = NULL;
+    fill->length = 0;
+}
+
+/*
+ * entry_retired - Called once the grace period of an evicted entry has
+ *     passed. No reader can find it any more, so the cache's own reference
+ *     goes away; pinned readers keep it alive until they release it.
+ */
+static void entry_retired(void *ptr) {
+    cache_release(ptr);
+}
+
+/* Put entry on the expiry wheel slot for its deadline second; caller holds sh->sem */
+static void wheel_add(cache_shard_t *sh, cache_entry_t *entry) {
+    int slot = entry_deadline(entry) % CACHE_WHEEL_SLOTS;
+
+    entry->wslot = slot;
+    entry->wprev = NULL;
+    entry->wnext = sh->wheel[slot];
+    if (entry->wnext != NULL) {
+        entry->wnext->wprev = entry;
+    }
+    sh->wheel[slot] = entry;
+}
+
+static void wheel_remove(cache_shard_t *sh, cache_entry_t *entry) {
+    if (entry->wslot < 0) {
+        return;
+    }
+    if (entry->wprev == NULL) {
+        sh->wheel[entry->wslot] = entry->wnext;
+    } else {
+        entry->wprev->wnext = entry->wnext;
+    }
+    if (entry->wnext != NULL) {
+        entry->wnext->wprev = entry->wprev;
+    }
+    entry->wslot = -1;
+}
+
+/* Drop an entry that is no longer on any list from the index and the wheel; caller holds sh->sem */
+static void entry_unlink(cache_shard_t *sh, cache_entry_t *old) {
+    long purge_bytes = sh->purge.bytes;
+
+    index_remove(sh, old);
+    wheel_remove(sh, old);
+    purge_index_remove(&sh->purge, &old->purge);
+    sh->nentries--;
+    sh->total_size -= old->size + purge_bytes - sh->purge.bytes;
+    epoch_retire(&old->retire, old, entry_retired); // reader가 모두 빠져나간 뒤 캐시 참조 해제
+}
+
+static void entry_evict(cache_shard_t *sh, cache_entry_t *old) {
+    sh->evictions++;
+    entry_unlink(sh, old);
+}
+
+/* Take an entry off its list wherever it is and unlink it; caller holds sh->sem */
+static void entry_remove(cache_shard_t *sh, cache_entry_t *old) {
+    if (old->list == POLICY_LIST_WINDOW) {
+        policy_list_remove(sh, old);
+    } else {
+        cache.policy->on_remove(sh, old, 0); // 만료나 PURGE는 정책의 ghost에 남기지 않는다
+    }
+    entry_unlink(sh, old);
+}
+
+/* Reclaim an expired entry; caller holds sh->sem */
+static void entry_expire(cache_shard_t *sh, cache_entry_t *old) {
+    sh->expirations++;
+    entry_remove(sh, old);
+}
+
+/* Evict the policy's victims until the shard has room for length more bytes */
+static void main_make_room(cache_shard_t *sh, long length) {
+    cache_entry_t *victim;
+
+    // 캐시 용량 초과 시 선택된 정책이 고른 항목부터 제거
+    while (sh->total_size + length > sh->max_size &&
+           (victim = cache.policy->choose_victim(sh)) != NULL) {
+        cache.policy->on_remove(sh, victim, 1);
+        disk_demote(victim); // 디스크 계층이 켜져 있으면 버리기 전에 기록을 맡긴다
+        entry_evict(sh, victim);
+    }
+}
+
+/*
+ * window_evict - TinyLFU admission for an entry leaving the window. If
+ *     the main lists have room the candidate simply moves in. Otherwise it
+ *     is admitted only when the sketch has seen it more often than the
+ *     policy's victim it would replace; a loser is evicted instead, so
+ *     one-hit wonders cannot flush popular objects.
+ */
+static void window_evict(cache_shard_t *sh, cache_entry_t *cand) {
+    cache_entry_t *victim;
+
+    // 이미 total_size에는 후보가 포함되어 있으므로 추가 공간 없이 비교
+    if (sh->total_size > sh->max_size && (victim = cache.policy->choose_victim(sh)) != NULL &&
+        sketch_frequency(&sh->sketch, cand->hash) <= sketch_frequency(&sh->sketch, victim->hash)) {
+        sh->rejections++;
+        entry_evict(sh, cand);
+        return;
+    }
+    main_make_room(sh, 0);
+    cache.policy->on_insert(sh, cand);
+}
+
+/* Shrink the last chunk of a completed fill to its smallest size class */
+static void fill_trim(cache_fill_t *fill) {
+    buf_chunk_t **pp = &fill->head;
+
+    while (*pp != fill->tail) {
+        pp = &(*pp)->next;
+    }
+    *pp = fill->tail = bufpool_trim(fill->tail);
+}
+
+/*
+ * entry_footprint - Memory an entry holds: its slab item and its chunks.
+ *     A shared body counts only for the entry that stored it (own_body).
+ */
+static long entry_footprint(cache_entry_t *entry, int own_body) {
+    long n = slab_item_size(entry);
+
+    if (entry->mapped != NULL) {
+        return n + entry->content_length;
+    }
+    buf_chunk_t *end = entry->blob != NULL && !own_body ? entry->blob->chunks : NULL;
+    for (buf_chunk_t *c = entry->chunks; c != end; c = c->next) {
+        n += slab_item_size(c);
+    }
+    if (entry->blob != NULL && own_body) {
+        n += sizeof(blob_t);
+    }
+    return n;
+}
+
+/* Lock-free check whether uri is cached, without counting a hit or miss */
+int cache_contains(const char *uri, unsigned long hash) {
+    cache_shard_t *sh = shard_for(hash);
+
+    epoch_enter();
+    cache_entry_t *found = index_find(__atomic_load_n(&sh->index, __ATOMIC_ACQUIRE), uri, hash);
+    int fresh = found != NULL && !entry_expired(found, time(NULL));
+    epoch_exit();
+    return fresh;
+}
+
+/* Allocate an unlinked entry for uri from the slab, sized to the URI */
+static cache_entry_t *entry_alloc(const char *uri, unsigned long hash, int content_length, long expires) {
+    size_t urilen = strlen(uri);
+    cache_entry_t *entry = slab_alloc(sizeof(cache_entry_t) + urilen + 1);
+
+    memcpy(entry->uri, uri, urilen + 1);
+    entry->hash = hash;
+    entry->chunks = NULL;
+    entry->blob = NULL;
+    entry->blob_owner = 0;
+    entry->mapped = NULL;
+    entry->content_length = content_length;
+    entry->size = content_length;
+    entry->expires = expires;
+    entry->stale_until = 0;
+    entry->refreshing = 0;
+    entry->wslot = -1;
+    entry->revalidate = 0;
+    entry->gzip = 0;
+    entry->referenced = 0;
+    entry->freq = 0;
+    entry->list = POLICY_LIST_NONE;
+    entry->refcnt = 1; // 캐시가 가진 참조
+    entry->prev = entry->next = NULL;
+    entry->purge.rnode = NULL;
+    entry->purge.tags = NULL;
+    return entry;
+}
+
+/*
+ * entry_publish - Link a new entry into its shard and make room for it.
+ *     A warm entry restored from a snapshot skips the admission window:
+ *     the sketch has not seen it yet and would reject it. keys are the
+ *     entry's surrogate keys, or NULL. A nonzero gen is the shard's
+ *     purge generation when the body was fetched; if a PURGE has run
+ *     since, the body may be the purged one and is not linked. Returns 1
+ *     if the entry was linked; otherwise it has been released.
+ */
+static int entry_publish(cache_shard_t *sh, cache_entry_t *entry, int warm, const char *keys, long gen) {
+    if (sem_wait(&sh->sem) < 0) { // 세마포어 대기 (잠금)
+        perror("sem_wait failed");
+        cache_release(entry);
+        return 0;
+    }
+    if (gen != 0 && gen != sh->purge_gen) {
+        if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+            perror("sem_post failed");
+        }
+        cache_release(entry); // 가져오는 동안 PURGE가 지나갔다
+        return 0;
+    }
+
+    // 다른 스레드가 같은 URI를 먼저 채웠다면 기존 항목을 유지 (만료된 항목이면 교체)
+    cache_entry_t *old = index_find(sh->index, entry->uri, entry->hash);
+    if (old != NULL && entry_expired(old, time(NULL))) {
+        entry_expire(sh, old);
+        old = NULL;
+    }
+    if (old != NULL) {
+        if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+            perror("sem_post failed");
+        }
+        cache_release(entry);
+        return 0;
+    }
+
+    // 인덱스와 크기에 먼저 반영한 뒤 eviction 목록을 정리
+    long purge_bytes = sh->purge.bytes;
+    index_link(sh->index, entry);
+    purge_index_add(&sh->purge, &entry->purge, entry, entry->uri, keys);
+    if (entry->expires != 0) {
+        wheel_add(sh, entry);
+    }
+    sh->total_size += entry->size + sh->purge.bytes - purge_bytes;
+    if (++sh->nentries > sh->index->nbuckets) {
+        index_grow(sh); // 부하율이 1을 넘으면 버킷 수를 두 배로
+    }
+
+    if (cache.admission && !warm) {
+        // 새 항목은 먼저 admission window에 들어가고, window를 넘치면 main과 경쟁
+        cache_list_t *win = &sh->lists[POLICY_LIST_WINDOW];
+        policy_list_append(sh, POLICY_LIST_WINDOW, entry);
+        while (win->bytes > sh->win_max && win->head != NULL) {
+            cache_entry_t *cand = win->head;
+            policy_list_remove(sh, cand);
+            window_evict(sh, cand);
+        }
+    } else {
+        main_make_room(sh, 0);
+        cache.policy->on_insert(sh, entry);
+    }
+
+    if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+        perror("sem_post failed");
+    }
+    return 1;
+}
+
+/* Entries with validators can be revalidated once stale instead of refetched */
+static int has_validators(const http_response_t *resp) {
+    return resp->etag[0] != '\0' || resp->last_modified != 0;
+}
+
+/*
+ * response_expiry - Decide from parsed response headers whether the
+ *     response may be cached and until when. Returns the absolute expiry
+ *     time, 0 for never, or -1 if it must not be stored. Explicit
+ *     lifetimes (s-maxage, max-age, Expires) win; otherwise 404/410 and
+ *     5xx responses get the short negative TTLs, and only plain
+ *     successful responses to URIs without a query get a heuristic
+ *     lifetime. A response with validators that is already stale, or
+ *     marked no-cache, is stored stale so the next request revalidates it.
+ */
+static long response_expiry(const char *uri, const http_response_t *resp) {
+    long now = time(NULL), lifetime;
+    long date = resp->date != 0 ? resp->date : now;
+    int validators = has_validators(resp);
+
+    if (resp->no_store || resp->private || resp->status == 206 || resp->status == 304) {
+        return -1; // 공유 캐시가 저장하면 안 되거나 완전한 응답이 아니다
+    }
+    if (resp->no_cache) {
+        return validators ? now : -1; // 매번 재검증해야 하므로 처음부터 stale로 저장
+    }
+
+    if (resp->s_maxage >= 0) {
+        lifetime = resp->s_maxage;
+    } else if (resp->max_age >= 0) {
+        lifetime = resp->max_age;
+    } else if (resp->expires != 0) {
+        lifetime = resp->expires - date;
+    } else if (resp->status == 404 || resp->status == 410) {
+        lifetime = cache.negative_ttl; // 실패 응답은 짧게만 기억해 재시도가 origin으로 몰리지 않게 한다
+    } else if (resp->status >= 500 && resp->status <= 504) {
+        lifetime = cache.error_ttl;
+    } else {
+        // 명시적인 수명이 없으면 휴리스틱은 쿼리 없는 정상 응답에만 적용
+        switch (resp->status) {
+        case 200: case 203: case 204: case 300: case 301: case 308:
+            break;
+        default:
+            return -1;
+        }
+        if (strcspn(uri, "?") < strcspn(uri, "\n")) {
+            return -1; // 변형 키의 헤더 값에 있는 '?'는 쿼리가 아니다
+        }
+        if (resp->last_modified != 0 && resp->last_modified < date) {
+            lifetime = (date - resp->last_modified) * CACHE_HEURISTIC_PERCENT / 100;
+            lifetime = MIN(lifetime, CACHE_HEURISTIC_MAX);
+        } else if (cache.default_ttl > 0) {
+            lifetime = cache.default_ttl;
+        } else {
+            return 0; // 기본 수명 0: 예전처럼 용량에 밀려날 때까지 유지
+        }
+    }
+
+    lifetime -= resp->age;
+    if (lifetime > 0) {
+        return now + lifetime;
+    }
+    return validators ? now : -1;
+}
+
+/* End of the stale-while-revalidate window after expires, 0 if none */
+static long stale_window(long expires, const http_response_t *resp) {
+    return expires > 0 && resp->swr > 0 ? expires + resp->swr : 0;
+}
+
+/*
+ * fill_header - Parse the response headers at the start of a fill. They
+ *     normally fit in the first chunk; only longer ones are copied out.
+ */
+static int fill_header(cache_fill_t *fill, http_response_t *resp) {
+    char hdr[HTTP_MAX_HEADER];
+    int n = 0;
+
+    if (http_parse_response(fill->head->data, fill->head->len, resp) == 0 && resp->header_len > 0) {
+        return 0;
+    }
+    for (buf_chunk_t *c = fill->head; c != NULL && n < HTTP_MAX_HEADER; c = c->next) {
+        int k = MIN(c->len, HTTP_MAX_HEADER - n);
+        memcpy(hdr + n, c->data, k);
+        n += k;
+    }
+    if (http_parse_response(hdr, n, resp) < 0 || resp->header_len == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Surrogate keys of an entry that is not linked yet, read from its stored headers */
+static const char *entry_keys(cache_entry_t *entry, char *keys, int size) {
+    char hdr[HTTP_MAX_HEADER];
+    int n = cache_read(entry, 0, hdr, sizeof(hdr));
+
+    return purge_keys(hdr, n, keys, size) ? keys : NULL;
+}
+
+/* Record the Vary list names for the URI that the (possibly variant) key uri was built from */
+static void vary_learn(const char *uri, const char *names) {
+    char base[MAXLINE];
+    int n = strcspn(uri, "\n");
+
+    memcpy(base, uri, n);
+    base[n] = '\0';
+    vary_record(base, cache_hash(base), names);
+}
+
+/*
+ * variant_mismatch - Whether a response that varies by resp->vary was
+ *     fetched under a key built for other headers, or for none, as the
+ *     first fetch of a URI is. Its Vary list is recorded, so the next
+ *     request builds the right key.
+ */
+static int variant_mismatch(const char *uri, const http_response_t *resp) {
+    char names[MAXLINE];
+    int len = 0;
+
+    if (resp->vary[0] == '\0') {
+        return 0; // 변형이 없는 응답은 어떤 키로든 저장할 수 있다
+    }
+    for (const char *p = strchr(uri, '\n'); p != NULL; p = strchr(p + 1, '\n')) {
+        int k = strcspn(p + 1, ":\n");
+        if (len + k + 2 > (int)sizeof(names)) {
+            break;
+        }
+        if (len > 0) {
+            names[len++] = ',';
+        }
+        memcpy(names + len, p + 1, k);
+        len += k;
+    }
+    names[len] = '\0';
+    if (strcmp(names, resp->vary) == 0) {
+        return 0;
+    }
+    if (strcmp(resp->vary, "*") != 0) {
+        vary_learn(uri, resp->vary);
+    }
+    return 1;
+}
+
+/*
+ * variant_rekey - Build in key the variant key under which a response
+ *     that varies by resp->vary belongs, from the headers of the request
+ *     that fetched it, so the response is stored rather than dropped.
+ *     The fill's purge generation moves to the variant's shard. Returns
+ *     -1 if the request headers are unknown, the response varies by '*',
+ *     the key does not fit or a PURGE has run since the fetch began.
+ */
+static int variant_rekey(const char *uri, unsigned long hash, const http_response_t *resp,
+                         cache_fill_t *fill, char *key, int size) {
+    char base[MAXLINE];
+    int n = strcspn(uri, "\n");
+
+    if (fill->hdrs == NULL || strcmp(resp->vary, "*") == 0) {
+        return -1;
+    }
+    memcpy(base, uri, n);
+    base[n] = '\0';
+    if (http_variant_key(base, resp->vary, fill->hdrs, key, size) < 0) {
+        return -1;
+    }
+    if (fill->gen != 0) {
+        // 새 샤드의 세대를 먼저 읽어야 그 사이의 PURGE를 둘 중 하나에서 보게 된다
+        long gen = cache_purge_gen(cache_hash(key));
+        if (cache_purge_gen(hash) != fill->gen) {
+            return -1;
+        }
+        fill->gen = gen;
+    }
+    return 0;
+}
+
+/*
+ * cache_insert - Publish a completed fill under uri. The fill's chunks
+ *     become the entry's body without another copy, except that a body
+ *     already cached under another URI is shared instead; if the object
+ *     is not cached they go back to the pool. A response that varies
+ *     by request header goes under the variant key of the request in
+ *     fill->hdrs if uri is not already that key. Either way the fill is
+ *     consumed.
+ */
+void cache_insert(const char *uri, unsigned long hash, cache_fill_t *fill) {
+    cache_shard_t *sh = shard_for(hash);
+    http_response_t resp;
+    char keys[MAXLINE], variant[MAXLINE];
+    const char *tags = NULL;
+
+    if (fill->oversized || fill->head == NULL) {
+        cache_fill_discard(fill);
+        return;
+    }
+    int parsed = fill_header(fill, &resp) == 0;
+    if (fill->expires < 0 && (!parsed || (fill->expires = response_expiry(uri, &resp)) < 0)) {
+        cache_fill_discard(fill); // 저장할 수 없는 응답이거나 이미 만료됨
+        return;
+    }
+    if (parsed && variant_mismatch(uri, &resp)) {
+        if (variant_rekey(uri, hash, &resp, fill, variant, sizeof(variant)) < 0) {
+            cache_fill_discard(fill);
+            return;
+        }
+        uri = variant; // 가져온 요청이 고른 변형으로 저장
+        hash = cache_hash(uri);
+        sh = shard_for(hash);
+    }
+
+    // 이미 캐시된 URI라면 할당 없이 바로 반납 (잠금 없는 확인)
+    if (cache_contains(uri, hash)) {
+        cache_fill_discard(fill);
+        return;
+    }
+
+    // 새로운 캐시 항목 생성 (잠금 밖에서)
+    fill_trim(fill);
+    cache_entry_t *new_entry = entry_alloc(uri, hash, fill->length, fill->expires);
+    long shared = parsed ? dedup_attach(fill, resp.header_len, &new_entry->blob) : 0;
+    new_entry->chunks = fill->head; // 복사 없이 chunk 체인을 넘겨받는다
+    new_entry->blob_owner = new_entry->blob != NULL && shared == 0;
+    new_entry->size = entry_footprint(new_entry, shared == 0); // 이미 있던 본문은 다시 세지 않는다
+    if (parsed) {
+        new_entry->revalidate = has_validators(&resp);
+        new_entry->gzip = resp.encoding == HTTP_ENCODING_GZIP;
+        new_entry->stale_until = stale_window(fill->expires, &resp);
+        if (resp.surrogate_key) {
+            tags = entry_keys(new_entry, keys, sizeof(keys));
+        }
+    }
+    fill->head = fill->tail = NULL;
+    entry_publish(sh, new_entry, 0, tags, fill->gen);
+}
+
+/*
+ * cache_insert_mapped - Publish an object whose body lives in a mapped
+ *     snapshot. Nothing is copied; the pages are faulted in on the first
+ *     hit. Returns 1 if it was cached. Either way the entry's reference
+ *     to the mapping is dropped through snapshot_unref() when it goes.
+ */
+int cache_insert_mapped(const char *uri, unsigned long hash, const char *body, int length, long expires) {
+    cache_entry_t *new_entry = entry_alloc(uri, hash, length, expires);
+    http_response_t resp;
+    char keys[MAXLINE];
+    const char *tags = NULL;
+
+    new_entry->mapped = body;
+    new_entry->size = entry_footprint(new_entry, 1);
+    if (http_parse_response(body, MIN(length, HTTP_MAX_HEADER), &resp) == 0) {
+        new_entry->revalidate = has_validators(&resp);
+        new_entry->gzip = resp.encoding == HTTP_ENCODING_GZIP;
+        new_entry->stale_until = stale_window(expires, &resp);
+        if (resp.surrogate_key) {
+            tags = entry_keys(new_entry, keys, sizeof(keys));
+        }
+        if (resp.vary[0] != '\0' && strchr(uri, '\n') != NULL) {
+            vary_learn(uri, resp.vary); // 재시작 후에도 변형 키로 찾을 수 있게
+        }
+    }
+    return entry_publish(shard_for(hash), new_entry, 1, tags, 0);
+}
+
+/*
+ * cache_revalidate - The origin answered a conditional request for the
+ *     pinned, stale entry with the 304 in hdr. Give the entry a new
+ *     lifetime in place, keeping its body. Freshness headers missing
+ *     from the 304 are taken from the stored response.
+ */
+void cache_revalidate(cache_entry_t *entry, const char *hdr, int len) {
+    char stored[HTTP_MAX_HEADER];
+    http_response_t old, resp;
+    cache_shard_t *sh = shard_for(entry->hash);
+
+    if (http_parse_response(hdr, len, &resp) < 0 ||
+        http_parse_response(stored, cache_read(entry, 0, stored, sizeof(stored)), &old) < 0) {
+        return;
+    }
+    if (resp.max_age < 0 && resp.s_maxage < 0 && resp.expires == 0 && !resp.no_cache && !resp.no_store) {
+        resp.max_age = old.max_age;
+        resp.s_maxage = old.s_maxage;
+        resp.expires = old.expires;
+        resp.swr = old.swr;
+        resp.no_cache = old.no_cache;
+        resp.private = old.private;
+    }
+    if (resp.etag[0] == '\0') {
+        strcpy(resp.etag, old.etag);
+    }
+    if (resp.last_modified == 0) {
+        resp.last_modified = old.last_modified;
+    }
+    resp.status = old.status; // 304가 아니라 저장된 응답의 수명을 계산한다
+    long expires = response_expiry(entry->uri, &resp);
+    if (expires < 0) {
+        return; // 더 이상 저장할 수 없는 응답: stale 상태로 두고 제거는 정책에 맡긴다
+    }
+
+    if (sem_wait(&sh->sem) < 0) { // 세마포어 대기 (잠금)
+        perror("sem_wait failed");
+        return;
+    }
+    if (index_find(sh->index, entry->uri, entry->hash) == entry) {
+        wheel_remove(sh, entry);
+        __atomic_store_n(&entry->stale_until, stale_window(expires, &resp), __ATOMIC_RELAXED);
+        __atomic_store_n(&entry->expires, expires, __ATOMIC_RELEASE); // lookup은 잠금 없이 읽는다
+        if (expires != 0) {
+            wheel_add(sh, entry);
+        }
+        sh->revalidations++;
+    }
+    if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+        perror("sem_post failed");
+    }
+}
+
+/*
+ * cache_purge_gen - The purge generation of hash's shard. A fetch records
+ *     it in cache_fill_t.gen before asking the origin, and the disk tier
+ *     with each demotion, so that a response caught in flight by a PURGE
+ *     is not stored afterwards.
+ */
+long cache_purge_gen(unsigned long hash) {
+    return __atomic_load_n(&shard_for(hash)->purge_gen, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * cache_purge - Invalidate uri at once, fresh or stale, instead of waiting
+ *     for it to expire or be evicted. Readers that have it pinned finish
+ *     undisturbed, and fills of the shard begun before now are not
+ *     published. Returns the number of entries removed (0 or 1).
+ */
+long cache_purge(const char *uri, unsigned long hash) {
+    cache_shard_t *sh = shard_for(hash);
+
+    if (sem_wait(&sh->sem) < 0) { // 세마포어 대기 (잠금)
+        perror("sem_wait failed");
+        return 0;
+    }
+    __atomic_add_fetch(&sh->purge_gen, 1, __ATOMIC_RELEASE); // 진행 중인 fill이 옛 응답을 다시 넣지 못하게
+    cache_entry_t *entry = index_find(sh->index, uri, hash);
+    if (entry != NULL) {
+        sh->purges++;
+        entry_remove(sh, entry);
+    }
+    if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+        perror("sem_post failed");
+    }
+    return entry != NULL;
+}
+
+/* Entries matched in a shard's purge index, removed once the walk is over */
+typedef struct {
+    cache_entry_t **v;
+    int n;
+    int cap;
+} purge_set_t;
+
+static void purge_collect(void *entry, void *arg) {
+    purge_set_t *set = arg;
+
+    if (set->n == set->cap) {
+        set->cap = set->cap > 0 ? set->cap * 2 : 64;
+        set->v = Realloc(set->v, set->cap * sizeof(cache_entry_t *));
+    }
+    set->v[set->n++] = entry;
+}
+
+/* Remove the entries of every shard that the index lookup fn finds for key */
+static long purge_matches(void (*fn)(purge_index_t *, const char *, purge_visit_t, void *), const char *key) {
+    long purged = 0;
+
+    // 모든 샤드의 세대를 먼저 올려야 다른 샤드로 옮겨 저장되는 변형도 놓치지 않는다
+    for (int i = 0; i < cache.nshards; i++) {
+        __atomic_add_fetch(&cache.shards[i].purge_gen, 1, __ATOMIC_RELEASE);
+    }
+    for (int i = 0; i < cache.nshards; i++) {
+        cache_shard_t *sh = &cache.shards[i];
+        purge_set_t set = { NULL, 0, 0 };
+
+        if (sem_wait(&sh->sem) < 0) { // 세마포어 대기 (잠금)
+            perror("sem_wait failed");
+            continue;
+        }
+        fn(&sh->purge, key, purge_collect, &set);
+        for (int k = 0; k < set.n; k++) {
+            entry_remove(sh, set.v[k]);
+        }
+        sh->purges += set.n;
+        if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+            perror("sem_post failed");
+        }
+        Free(set.v);
+        purged += set.n;
+    }
+    return purged;
+}
+
+/* Invalidate every entry whose URI starts with prefix; returns how many went */
+long cache_purge_prefix(const char *prefix) {
+    return purge_matches(purge_index_prefix, prefix);
+}
+
+/* Invalidate every entry the origin tagged with the surrogate key tag */
+long cache_purge_tag(const char *tag) {
+    return purge_matches(purge_index_tag, tag);
+}
+
+/*
+ * cache_resize - Give the shards a new total budget of max_size bytes
+ *     and evict at once down to it. Called by the memory accountant when
+ *     pressure moves the budget.
+ */
+void cache_resize(long max_size) {
+    for (int i = 0; i < cache.nshards; i++) {
+        cache_shard_t *sh = &cache.shards[i];
+        cache_list_t *win = &sh->lists[POLICY_LIST_WINDOW];
+
+        if (sem_wait(&sh->sem) < 0) { // 세마포어 대기 (잠금)
+            perror("sem_wait failed");
+            continue;
+        }
+        sh->max_size = max_size / cache.nshards;
+        sh->win_max = cache.admission ? sh->max_size * CACHE_WINDOW_PERCENT / 100 : 0;
+        if (cache.policy->on_resize != NULL) {
+            cache.policy->on_resize(sh);
+        }
+        while (win->bytes > sh->win_max && win->head != NULL) {
+            cache_entry_t *cand = win->head;
+            policy_list_remove(sh, cand);
+            window_evict(sh, cand);
+        }
+        main_make_room(sh, 0);
+        if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+            perror("sem_post failed");
+        }
+    }
+}
+
+/* Reclaim the expired entries in one wheel slot of every shard */
+static void sweep_slot(int slot, long now) {
+    for (int i = 0; i < cache.nshards; i++) {
+        cache_shard_t *sh = &cache.shards[i];
+
+        if (sem_wait(&sh->sem) < 0) { // 세마포어 대기 (잠금)
+            perror("sem_wait failed");
+            continue;
+        }
+        cache_entry_t *e = sh->wheel[slot];
+        while (e != NULL) {
+            cache_entry_t *wnext = e->wnext;
+            if (entry_deadline(e) > now) {
+                // 바퀴를 한 바퀴 이상 남긴 항목은 그대로 둔다
+            } else if (e->revalidate) {
+                wheel_remove(sh, e); // 재검증할 수 있으니 stale 상태로 남겨 둔다
+            } else {
+                entry_expire(sh, e);
+            }
+            e = wnext;
+        }
+        if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+            perror("sem_post failed");
+        }
+    }
+}
+
+/* Does entry or any chunk of its body live in [lo, hi)? */
+static int entry_in_range(cache_entry_t *e, void *lo, void *hi) {
+    if ((void *)e >= lo && (void *)e < hi) {
+        return 1;
+    }
+    for (buf_chunk_t *c = e->chunks; c != NULL; c = c->next) {
+        if ((void *)c >= lo && (void *)c < hi) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * cache_evict_page - Eviction callback for slab_automove(): drop every
+ *     entry that holds memory on the slab page [lo, hi), whatever its
+ *     place in the policy order, and the ghost nodes on it. The items go
+ *     back to the page once the epoch grace period ends.
+ */
+static void cache_evict_page(void *lo, void *hi) {
+    for (int i = 0; i < cache.nshards; i++) {
+        cache_shard_t *sh = &cache.shards[i];
+
+        if (sem_wait(&sh->sem) < 0) { // 세마포어 대기 (잠금)
+            perror("sem_wait failed");
+            continue;
+        }
+        for (int b = 0; b < sh->index->nbuckets; b++) {
+            cache_entry_t *e = sh->index->buckets[b];
+            while (e != NULL) {
+                cache_entry_t *hnext = e->hnext;
+                if (entry_in_range(e, lo, hi)) {
+                    if (e->list == POLICY_LIST_WINDOW) {
+                        policy_list_remove(sh, e);
+                    } else {
+                        cache.policy->on_remove(sh, e, 1);
+                    }
+                    disk_demote(e); // 용량 축출과 같이 디스크 계층에 먼저 맡긴다
+                    entry_evict(sh, e);
+                }
+                e = hnext;
+            }
+        }
+        policy_ghost_drop(sh, lo, hi);
+        if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+            perror("sem_post failed");
+        }
+    }
+}
+
+/*
+ * cache_sweeper - Expiry thread. Once a second it visits the wheel slots
+ *     of the seconds that have passed and reclaims what has expired, so
+ *     lookups never pay for cleanup. Entries expiring more than
+ *     CACHE_WHEEL_SLOTS seconds out share a slot with nearer ones and are
+ *     simply skipped until their round comes. It also frees what the
+ *     epoch scheme still holds once the readers have moved on, and lets
+ *     the slab allocator move a page to a class that is short of them.
+ */
+static void *cache_sweeper(void *vargp) {
+    long last = time(NULL);
+
+    Pthread_detach(pthread_self());
+    for (;;) {
+        sleep(1);
+        long now = time(NULL);
+        if (now - last > CACHE_WHEEL_SLOTS) {
+            last = now - CACHE_WHEEL_SLOTS; // 오래 멈췄다면 전체를 한 번만 돈다
+        }
+        while (last < now) {
+            last++;
+            sweep_slot(last % CACHE_WHEEL_SLOTS, now);
+        }
+        epoch_reclaim(); // 조용할 때도 회수가 밀리지 않게
+        slab_automove(cache_evict_page);
+    }
+    return NULL;
+}
+
+/*
+ * cache_walk - Call fn on every cached entry, shard by shard, in each
+ *     shard's eviction-list order (oldest first). A shard is locked only
+ *     while its entries are pinned, so fn runs unlocked and may block.
+ */
+void cache_walk(void (*fn)(cache_entry_t *entry, void *arg), void *arg) {
+    for (int i = 0; i < cache.nshards; i++) {
+        cache_shard_t *sh = &cache.shards[i];
+        cache_entry_t **pinned;
+        int n = 0;
+
+        if (sem_wait(&sh->sem) < 0) { // 세마포어 대기 (잠금)
+            perror("sem_wait failed");
+            continue;
+        }
+        pinned = Malloc((sh->nentries + 1) * sizeof(cache_entry_t *));
+        for (int l = 0; l < POLICY_NLISTS; l++) {
+            for (cache_entry_t *e = sh->lists[l].head; e != NULL; e = e->next) {
+                __atomic_fetch_add(&e->refcnt, 1, __ATOMIC_RELAXED);
+                pinned[n++] = e;
+            }
+        }
+        if (sem_post(&sh->sem) < 0) { // 세마포어 해제
+            perror("sem_post failed");
+        }
+
+        for (int k = 0; k < n; k++) {
+            fn(pinned[k], arg);
+            cache_release(pinned[k]);
+        }
+        Free(pinned);
+    }
+}
+
+/*
+ * cache_print_stats - Dump the cache counters to stdout. Only uses the
+ *     sio routines and plain loads, so it is safe to call from a signal
+ *     handler while worker threads keep running.
+ */
+void cache_print_stats(void) {
+    long hits = 0, misses = 0, entries = 0, bytes = 0, evictions = 0, rejections = 0, expirations = 0, revalidations = 0;
+    long purges = 0;
+
+    for (int i = 0; i < cache.nshards; i++) {
+        cache_shard_t *sh = &cache.shards[i];
+        hits += __atomic_load_n(&sh->hits, __ATOMIC_RELAXED);
+        misses += __atomic_load_n(&sh->misses, __ATOMIC_RELAXED);
+        entries += sh->nentries;
+        bytes += sh->total_size;
+        evictions += sh->evictions;
+        rejections += sh->rejections;
+        expirations += sh->expirations;
+        revalidations += sh->revalidations;
+        purges += sh->purges;
+    }
+
+    Sio_puts("cache: policy=");
+    Sio_puts((char *)cache.policy->name);
+    Sio_puts(" shards=");
+    Sio_putl(cache.nshards);
+    Sio_puts(" hits=");
+    Sio_putl(hits);
+    Sio_puts(" misses=");
+    Sio_putl(misses);
+    Sio_puts(" hit_ratio=");
+    Sio_putl(hits + misses > 0 ? hits * 100 / (hits + misses) : 0);
+    Sio_puts("% entries=");
+    Sio_putl(entries);
+    Sio_puts(" bytes=");
+    Sio_putl(bytes);
+    Sio_puts(" evictions=");
+    Sio_putl(evictions);
+    Sio_puts(" rejections=");
+    Sio_putl(rejections);
+    Sio_puts(" expired=");
+    Sio_putl(expirations);
+    Sio_puts(" revalidated=");
+    Sio_putl(revalidations);
+    Sio_puts(" purged=");
+    Sio_putl(purges);
+    Sio_puts("\n");
+}
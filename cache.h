@@ -0,0 +1,171 @@
+/*
+ * cache.h - shared web object cache used by the proxy worker threads
+ */
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "csapp.h"
+#include "bufpool.h"
+#include "epoch.h"
+#include "sketch.h"
+#include "policy.h"
+#include "http.h"
+#include "purge.h"
+
+/* Recommended max cache and object sizes (override with -D for experiments) */
+#ifndef MAX_CACHE_SIZE
+#define MAX_CACHE_SIZE (5L * 1024 * 1024 * 1024) /* 5 GB */
+#endif
+#ifndef MAX_OBJECT_SIZE
+#define MAX_OBJECT_SIZE 102400
+#endif
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+#define CACHE_MIN_BUCKETS 256   /* Initial size of each shard's URI hash index */
+#define CACHE_DEFAULT_SHARDS 16 /* Shard count when -s is not given */
+#define CACHE_WINDOW_PERCENT 1  /* Share of each shard given to the admission window */
+#define CACHE_AVG_OBJECT_SIZE 8192 /* Used to size the frequency sketch and ghosts */
+#define CACHE_DEFAULT_POLICY "clock"
+#define CACHE_WHEEL_SLOTS 1024  /* One-second slots of each shard's expiry wheel */
+#define CACHE_DEFAULT_TTL 3600  /* Lifetime when a response gives no freshness info */
+#define CACHE_HEURISTIC_PERCENT 10 /* Of the time since Last-Modified */
+#define CACHE_HEURISTIC_MAX 86400  /* Cap on any heuristic lifetime */
+#define CACHE_NEGATIVE_TTL 30   /* Lifetime of 404/410 responses without freshness info */
+#define CACHE_ERROR_TTL 5       /* Lifetime of 5xx responses and origin connect failures */
+
+struct blob;
+
+/* Entries are slab items sized to their URI, which is stored inline at the end */
+typedef struct cache_entry {
+    unsigned long hash;          /* cache_hash(uri), computed once per request */
+    buf_chunk_t *chunks;         /* Object bytes, handed over by the fill */
+    struct blob *blob;           /* Shared body that chunks ends in, or NULL */
+    int blob_owner;              /* size includes the shared body (see dedup.h) */
+    const char *mapped;          /* Or: object bytes inside a restored snapshot */
+    int content_length;
+    int size;                    /* Bytes charged to the shard: slab item, chunks and an owned shared body */
+    long expires;                /* Absolute expiry time, 0 = never */
+    long stale_until;            /* Served stale while refreshing until then, 0 = not at all */
+    int refreshing;              /* A background refresh is queued or running */
+    int wslot;                   /* Expiry wheel slot, -1 if not on the wheel */
+    int revalidate;              /* Has ETag or Last-Modified: kept when stale */
+    int gzip;                    /* Body is gzip-encoded: inflated for clients without gzip */
+    int referenced;              /* CLOCK reference bit, set on every hit */
+    int freq;                    /* S3-FIFO hit counter (0..POLICY_S3_MAX_FREQ) */
+    int list;                    /* Index into the shard's lists[], or POLICY_LIST_NONE */
+    int refcnt;                  /* 1 for the cache itself + 1 per pinned reader */
+    struct cache_entry *prev;    /* 정책 리스트 안의 순서 (head가 가장 오래됨) */
+    struct cache_entry *next;
+    struct cache_entry *wprev;   /* 같은 만료 슬롯의 항목들 */
+    struct cache_entry *wnext;
+    struct cache_entry *hnext;   /* 같은 해시 버킷의 다음 항목 */
+    purge_links_t purge;         /* Its place in the shard's purge index */
+    epoch_node_t retire;         /* Links the entry into the epoch limbo list */
+    char uri[];                  /* NUL-terminated key */
+} cache_entry_t;
+
+/*
+ * The hash index is read without any lock. A resize builds a new index,
+ * publishes it with a single pointer store and retires the old one
+ * through the epoch allocator.
+ */
+typedef struct {
+    epoch_node_t retire;      // 교체된 인덱스를 epoch 해제 목록에 연결
+    int nbuckets;             // 버킷 수 (항상 2의 거듭제곱)
+    cache_entry_t *buckets[]; // URI 해시 인덱스 (chained)
+} cache_index_t;
+
+/*
+ * A shard owns a slice of the URI hash space with its own lock, index,
+ * eviction lists and byte budget, so inserts for different shards never
+ * contend with each other.
+ */
+typedef struct cache_shard {
+    cache_list_t lists[POLICY_NLISTS]; // 정책이 쓰는 리스트 + admission window
+    ghost_t ghost[POLICY_NGHOSTS];     // ARC/S3-FIFO가 기억하는 최근 제거 항목
+    long target;              // ARC: T1 목표 크기, S3-FIFO: small 큐 크기
+    long win_max;             // window 용량 (샤드 용량의 CACHE_WINDOW_PERCENT%)
+    cache_entry_t *wheel[CACHE_WHEEL_SLOTS]; // 만료 시각(초) % 슬롯 수로 나눈 timing wheel
+    sketch_t sketch;          // TinyLFU 빈도 추정 (admission 사용 시)
+    cache_index_t *index;     // lock-free reader가 보는 해시 인덱스
+    purge_index_t purge;      // PURGE용 URI radix tree와 surrogate key 목록 (잠금 필요)
+    long purge_gen;           // PURGE마다 증가; 그 전에 시작한 fill은 게시하지 않는다
+    int nentries;             // 현재 항목 수
+    long total_size;          // 현재 샤드가 쓰는 메모리 (항목, chunk, 인덱스, sketch)
+    long max_size;            // 샤드별 용량 (메모리 예산 / nshards, 압박에 따라 바뀜)
+    long hits;                // 누적 캐시 히트 수
+    long misses;              // 누적 캐시 미스 수
+    long evictions;           // 누적 제거 항목 수
+    long rejections;          // admission에서 탈락한 항목 수
+    long expirations;         // sweeper가 회수한 만료 항목 수
+    long revalidations;       // origin이 304로 갱신해 준 항목 수
+    long purges;              // PURGE로 무효화된 항목 수
+    sem_t sem;     // insert/evict 동기화를 위한 뮤텍스 (lookup은 사용하지 않음)
+} cache_shard_t;
+
+typedef struct {
+    cache_shard_t *shards;    // URI 해시로 선택되는 샤드 배열
+    int nshards;              // 샤드 수 (시작 시 -s 옵션으로 지정)
+    int admission;            // W-TinyLFU admission filter 사용 여부
+    const cache_policy_t *policy; // 제거 정책 (시작 시 -p 옵션으로 지정)
+    long default_ttl;         // 신선도 정보가 없는 응답의 수명 (0 = 무기한)
+    long negative_ttl;        // 404/410 응답의 수명 (0 = 캐시하지 않음)
+    long error_ttl;           // 5xx 응답의 수명 (0 = 캐시하지 않음)
+} cache_t;
+
+/* Startup settings, filled in from the command line */
+typedef struct {
+    int nshards;              // 샤드 수
+    long max_size;            // 전체 캐시 용량 (바이트)
+    int admission;            // W-TinyLFU admission filter 사용 여부
+    const char *policy;       // 제거 정책 이름 (policy_find()로 확인)
+    long default_ttl;         // 신선도 정보가 없는 응답의 수명 (초)
+    long negative_ttl;        // 404/410 응답의 수명 (초)
+    long error_ttl;           // 5xx 응답과 연결 실패의 수명 (초)
+} cache_config_t;
+
+/*
+ * A fill buffers one origin response while it is forwarded to the client.
+ * Bytes go into pool chunks; once the object grows past MAX_OBJECT_SIZE
+ * the chunks go back to the pool and the rest of the response is only
+ * forwarded. A complete fill is handed to cache_insert() as is.
+ */
+typedef struct {
+    buf_chunk_t *head;
+    buf_chunk_t *tail;
+    int length;               // 지금까지 버퍼링한 바이트 수
+    int oversized;            // MAX_OBJECT_SIZE 초과로 버퍼링을 중단했는지
+    long expires;             // -1이면 cache_insert()가 응답 헤더에서 계산
+    long gen;                 // 가져오기 시작할 때의 cache_purge_gen(), 0이면 확인하지 않음
+    const char *hdrs;         // 가져온 요청의 헤더; 응답이 Vary를 달고 오면 변형 키를 만든다 (NULL이면 버린다)
+} cache_fill_t;
+
+extern cache_t cache;
+
+unsigned long cache_hash(const char *uri);
+void cache_init(const cache_config_t *cfg);
+cache_entry_t *cache_lookup(const char *uri, unsigned long hash);
+cache_entry_t *cache_lookup_stale(const char *uri, unsigned long hash);
+int cache_contains(const char *uri, unsigned long hash);
+int cache_claim_refresh(cache_entry_t *entry);
+void cache_release(cache_entry_t *entry);
+int cache_write(int fd, cache_entry_t *entry);
+int cache_write_range(int fd, cache_entry_t *entry, long off, long len);
+int cache_read(cache_entry_t *entry, long off, char *buf, int n);
+void cache_revalidate(cache_entry_t *entry, const char *hdr, int len);
+void cache_fill_init(cache_fill_t *fill);
+void cache_fill_append(cache_fill_t *fill, const char *buf, int n);
+void cache_fill_discard(cache_fill_t *fill);
+void cache_insert(const char *uri, unsigned long hash, cache_fill_t *fill);
+int cache_insert_mapped(const char *uri, unsigned long hash, const char *body, int length, long expires);
+long cache_purge(const char *uri, unsigned long hash);
+long cache_purge_gen(unsigned long hash);
+long cache_purge_prefix(const char *prefix);
+long cache_purge_tag(const char *tag);
+void cache_resize(long max_size);
+void cache_walk(void (*fn)(cache_entry_t *entry, void *arg), void *arg);
+void cache_print_stats(void);
+
+#endif /* __CACHE_H__ */
@@ -0,0 +1,289 @@
+/*
+ * cachebench.c - Measure cache lookup throughput from 1 to 64 threads.
+ *
+ *     Every thread looks up random keys from a prefilled working set and
+ *     issues one insert per CACHEBENCH_WRITE_EVERY operations, so readers
+ *     race with the writer path the whole time. With -l each lookup is
+ *     also serialised on one semaphore, which reproduces the old global
+ *     cache.sem read path for comparison.
+ *
+ *     With -z the benchmark instead replays a synthetic trace on one
+ *     thread and reports the hit ratio: requests follow a Zipf
+ *     distribution over the working set, mixed with CACHEBENCH_ONE_HIT_PCT
+ *     percent of one-hit wonders that are never requested again.
+ *
+ *     With -x the object-size mix shifts: the cache is filled with small
+ *     objects, then for the given number of seconds large ones are
+ *     inserted while every CACHEBENCH_SHIFT_HOT-th small object stays hot.
+ *     The slab page count is printed each second; it should level off
+ *     near the cache size as slab_automove() hands the sparse small pages
+ *     over to the large class.
+ *
+ *     usage: ./cachebench [-l] [-s seconds] [-n keys] [-c shards]
+ *            ./cachebench -z requests [-n keys] [-c shards] [-m bytes] [-a 0|1] [-p policy]
+ *            ./cachebench -x seconds [-c shards] [-m bytes] [-a 0|1] [-p policy]
+ */
+#include "csapp.h"
+#include "cache.h"
+#include "slab.h"
+
+#define CACHEBENCH_MAX_THREADS 64
+#define CACHEBENCH_OBJ_SIZE 1024
+#define CACHEBENCH_WRITE_EVERY 100
+#define CACHEBENCH_ZIPF_S 0.9      /* Skew of the replayed trace */
+#define CACHEBENCH_ONE_HIT_PCT 30  /* Share of requests for never-repeated URIs */
+#define CACHEBENCH_MAX_REPLAY_OBJ (32 * 1024)
+#define CACHEBENCH_SHIFT_SMALL 200     /* Object size before the shift */
+#define CACHEBENCH_SHIFT_LARGE 3000    /* and after it */
+#define CACHEBENCH_SHIFT_HOT 100       /* One small object in this many stays hot */
+#define CACHEBENCH_SHIFT_HITS 10       /* Hot lookups per large insert */
+#define CACHEBENCH_SHIFT_RATE (4L * 1024 * 1024) /* Large bytes inserted per second */
+
+static int nkeys = 4096;
+static int seconds = 2;
+static int locked = 0;
+static int nshards = CACHE_DEFAULT_SHARDS;
+static long replay = 0;
+static int shift = 0;
+static long max_size = MAX_CACHE_SIZE;
+static int admission = 1;
+static const char *policy = CACHE_DEFAULT_POLICY;
+static volatile int stop;
+static sem_t lookup_mutex;
+static char body[CACHEBENCH_MAX_REPLAY_OBJ];
+
+typedef struct {
+    unsigned long seed;
+    long ops;
+} bench_arg_t;
+
+static void key_for(int k, char *uri) {
+    snprintf(uri, MAXLINE, "http://bench.local/objects/%d.txt", k);
+}
+
+/* xorshift64 generator, one per thread */
+static unsigned long next_rand(unsigned long *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static void *bench_thread(void *vargp) {
+    bench_arg_t *arg = vargp;
+    char uri[MAXLINE];
+    cache_entry_t *entry;
+    long ops = 0;
+
+    while (!stop) {
+        int k = next_rand(&arg->seed) % nkeys;
+        key_for(k, uri);
+        unsigned long hash = cache_hash(uri);
+        if (ops % CACHEBENCH_WRITE_EVERY == 0) {
+            cache_fill_t fill;
+            cache_fill_init(&fill);
+            cache_fill_append(&fill, body, CACHEBENCH_OBJ_SIZE);
+            fill.expires = 0; // 헤더 없는 합성 객체: 만료 없음
+            cache_insert(uri, hash, &fill);
+        } else {
+            if (locked) {
+                P(&lookup_mutex);
+            }
+            if ((entry = cache_lookup(uri, hash)) != NULL) {
+                cache_release(entry);
+            }
+            if (locked) {
+                V(&lookup_mutex);
+            }
+        }
+        ops++;
+    }
+    arg->ops = ops;
+    return NULL;
+}
+
+/*
+ * replay_trace - Single-threaded hit-ratio run: look every request up,
+ *     and fill and insert it on a miss, the way forward_request() does.
+ */
+static void replay_trace(void) {
+    char uri[MAXLINE];
+    double *cdf = Malloc(nkeys * sizeof(double));
+    unsigned long seed = 88172645463325252UL;
+    long hits = 0, bytes = 0, hit_bytes = 0;
+    double sum = 0;
+
+    for (int k = 0; k < nkeys; k++) {
+        sum += 1.0 / pow(k + 1, CACHEBENCH_ZIPF_S);
+        cdf[k] = sum;
+    }
+
+    for (long i = 0; i < replay; i++) {
+        if (next_rand(&seed) % 100 < CACHEBENCH_ONE_HIT_PCT) {
+            snprintf(uri, MAXLINE, "http://bench.local/once/%ld", i);
+        } else {
+            double u = (next_rand(&seed) >> 11) * (1.0 / 9007199254740992.0) * sum;
+            int lo = 0, hi = nkeys - 1;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (cdf[mid] >= u) {
+                    hi = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            key_for(lo, uri);
+        }
+
+        unsigned long hash = cache_hash(uri);
+        int size = 1024 + (hash >> 20) % (CACHEBENCH_MAX_REPLAY_OBJ - 1024);
+        cache_entry_t *entry = cache_lookup(uri, hash);
+        bytes += size;
+        if (entry != NULL) {
+            hits++;
+            hit_bytes += size;
+            cache_release(entry);
+        } else {
+            cache_fill_t fill;
+            cache_fill_init(&fill);
+            cache_fill_append(&fill, body, size);
+            fill.expires = 0;
+            cache_insert(uri, hash, &fill);
+        }
+    }
+
+    printf("replayed %ld requests, %d keys, %ld byte cache, admission %s\n",
+           replay, nkeys, max_size, admission ? "on" : "off");
+    printf("hit_ratio=%.2f%% byte_hit_ratio=%.2f%%\n",
+           100.0 * hits / replay, 100.0 * hit_bytes / bytes);
+    Free(cdf);
+}
+
+static void insert_object(const char *uri, unsigned long hash, int size) {
+    cache_fill_t fill;
+
+    cache_fill_init(&fill);
+    cache_fill_append(&fill, body, size);
+    fill.expires = 0;
+    cache_insert(uri, hash, &fill);
+}
+
+/*
+ * shift_mix - Fill the cache with small objects, then switch to large
+ *     ones at CACHEBENCH_SHIFT_RATE while a few of the small ones keep
+ *     being hit (and refilled if they were evicted), as a client would.
+ */
+static void shift_mix(void) {
+    char uri[MAXLINE];
+    long nsmall = 2 * max_size / CACHEBENCH_SHIFT_SMALL;
+    long per_tick = CACHEBENCH_SHIFT_RATE / CACHEBENCH_SHIFT_LARGE / 10;
+    long large = 0, hot = 0;
+
+    for (long k = 0; k < nsmall; k++) {
+        snprintf(uri, MAXLINE, "http://bench.local/small/%ld", k);
+        insert_object(uri, cache_hash(uri), CACHEBENCH_SHIFT_SMALL);
+    }
+    printf("%ld small objects into a %ld byte cache: %ld slab pages\n", nsmall, max_size, slab_pages());
+    printf("%8s %12s\n", "second", "slab_pages");
+
+    for (int tick = 0; tick < shift * 10; tick++) {
+        for (long i = 0; i < per_tick; i++, large++) {
+            snprintf(uri, MAXLINE, "http://bench.local/large/%ld", large);
+            insert_object(uri, cache_hash(uri), CACHEBENCH_SHIFT_LARGE);
+
+            for (int h = 0; h < CACHEBENCH_SHIFT_HITS; h++, hot++) {
+                long k = nsmall / 2 + hot % (nsmall / 2 / CACHEBENCH_SHIFT_HOT) * CACHEBENCH_SHIFT_HOT; // 아직 캐시에 남은 쪽
+                snprintf(uri, MAXLINE, "http://bench.local/small/%ld", k);
+                unsigned long hash = cache_hash(uri);
+                cache_entry_t *entry = cache_lookup(uri, hash);
+                if (entry != NULL) {
+                    cache_release(entry);
+                } else {
+                    insert_object(uri, hash, CACHEBENCH_SHIFT_SMALL);
+                }
+            }
+        }
+        usleep(100000);
+        if (tick % 10 == 9) {
+            printf("%8d %12ld\n", tick / 10 + 1, slab_pages());
+        }
+    }
+    fflush(stdout);
+    slab_print_stats();
+}
+
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char **argv) {
+    char uri[MAXLINE];
+    pthread_t tids[CACHEBENCH_MAX_THREADS];
+    bench_arg_t args[CACHEBENCH_MAX_THREADS];
+    int c;
+
+    while ((c = getopt(argc, argv, "ls:n:c:z:m:a:p:x:")) != -1) {
+        switch (c) {
+        case 'l': locked = 1; break;
+        case 's': seconds = atoi(optarg); break;
+        case 'n': nkeys = atoi(optarg); break;
+        case 'c': nshards = atoi(optarg); break;
+        case 'z': replay = atol(optarg); break;
+        case 'm': max_size = atol(optarg); break;
+        case 'a': admission = atoi(optarg) != 0; break;
+        case 'p': policy = optarg; break;
+        case 'x': shift = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-l] [-s seconds] [-n keys] [-c shards]\n", argv[0]);
+            fprintf(stderr, "       %s -z requests [-n keys] [-c shards] [-m bytes] [-a 0|1] [-p policy]\n", argv[0]);
+            fprintf(stderr, "       %s -x seconds [-c shards] [-m bytes] [-a 0|1] [-p policy]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    Sem_init(&lookup_mutex, 0, 1);
+    memset(body, 'x', sizeof(body));
+    cache_config_t cfg = { nshards, max_size, admission, policy, 0, 0, 0 };
+    cache_init(&cfg);
+    if (replay > 0) {
+        replay_trace();
+        return 0;
+    }
+    if (shift > 0) {
+        shift_mix();
+        return 0;
+    }
+    for (int k = 0; k < nkeys; k++) {
+        key_for(k, uri);
+        cache_fill_t fill;
+        cache_fill_init(&fill);
+        cache_fill_append(&fill, body, CACHEBENCH_OBJ_SIZE);
+        cache_insert(uri, cache_hash(uri), &fill);
+    }
+
+    printf("%s read path, %d keys, %d shards, %ds per run\n",
+           locked ? "locked" : "lock-free", nkeys, nshards, seconds);
+    printf("%8s %14s %14s\n", "threads", "ops/s", "ops/s/thread");
+    for (int n = 1; n <= CACHEBENCH_MAX_THREADS; n *= 2) {
+        long total = 0;
+
+        stop = 0;
+        for (int i = 0; i < n; i++) {
+            args[i].seed = 88172645463325252UL + i * 7919;
+            args[i].ops = 0;
+            Pthread_create(&tids[i], NULL, bench_thread, &args[i]);
+        }
+        double start = now();
+        sleep(seconds);
+        stop = 1;
+        for (int i = 0; i < n; i++) {
+            Pthread_join(tids[i], NULL);
+            total += args[i].ops;
+        }
+        double elapsed = now() - start;
+        printf("%8d %14.0f %14.0f\n", n, total / elapsed, total / elapsed / n);
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include <zlib.h>
+#include "csapp.h"
+#include "cache.h"
+#include "codec.h"
+
+static long compressed, raw_bytes, packed_bytes, inflated;
+
+/* Text-like media types compress well; images, video and archives do not */
+static int compressible(const char *type) {
+    char t[HTTP_MAX_TYPE];
+    int k = strcspn(type, ";");
+
+    for (int i = 0; i < k; i++) {
+        t[i] = tolower((unsigned char)type[i]);
+    }
+    t[k] = '\0';
+    return strncmp(t, "text/", 5) == 0 || strstr(t, "json") != NULL ||
+           strstr(t, "javascript") != NULL || strstr(t, "xml") != NULL;
+}
+
+/*
+ * pack_header - Copy the response header block hdr to out for the gzip
+ *     copy: Content-Length is replaced, a strong ETag is made weak, since
+ *     the bytes are no longer the origin's, and Content-Encoding and
+ *     Vary: Accept-Encoding are added. Returns the length.
+ */
+static int pack_header(const char *hdr, int hlen, char *out, int size, long zlen) {
+    char vary[MAXLINE] = "";
+    const char *p = hdr, *end = hdr + hlen, *eol;
+    int len = 0;
+
+    while ((eol = memchr(p, '\n', end - p)) != NULL && eol - p > 1) {
+        int n = eol + 1 - p;
+        if (strncasecmp(p, "Vary:", 5) == 0 && n - 5 < MAXLINE) {
+            memcpy(vary, p + 5, n - 5);
+            vary[strcspn(vary, "\r\n")] = '\0'; // 기존 목록에 Accept-Encoding을 덧붙인다
+        } else if (strncasecmp(p, "ETag:", 5) == 0 && p[5 + strspn(p + 5, " ")] == '"' && len + n + 2 < size) {
+            int k = 5 + strspn(p + 5, " ");
+            len += snprintf(out + len, size - len, "ETag: W/%.*s", n - k, p + k);
+        } else if (strncasecmp(p, "Content-Length:", 15) != 0 && len + n < size) {
+            memcpy(out + len, p, n);
+            len += n;
+        }
+        p = eol + 1;
+    }
+    len += snprintf(out + len, size - len, "Content-Encoding: gzip\r\nContent-Length: %ld\r\n", zlen);
+    if (vary[0] == '\0') {
+        len += snprintf(out + len, size - len, "Vary: Accept-Encoding\r\n\r\n");
+    } else if (http_has_token(vary, "Accept-Encoding") || http_has_token(vary, "*")) {
+        len += snprintf(out + len, size - len, "Vary:%s\r\n\r\n", vary);
+    } else {
+        len += snprintf(out + len, size - len, "Vary:%s, Accept-Encoding\r\n\r\n", vary);
+    }
+    return len;
+}
+
+/*
+ * codec_compress - Build in out a gzip copy of the complete response in
+ *     the chain of in, which is only read, so followers may still be
+ *     streaming it. Only cacheable 200 responses with a text-like type
+ *     and no encoding yet are compressed, and only when that saves
+ *     CODEC_MIN_SAVING percent. Returns 1 if out holds the copy.
+ */
+int codec_compress(const cache_fill_t *in, cache_fill_t *out) {
+    char copy[HTTP_MAX_HEADER], packed[HTTP_MAX_HEADER + MAXLINE];
+    const char *hdr = in->head->data;
+    http_response_t resp;
+    z_stream zs;
+    int n = in->head->len;
+
+    cache_fill_init(out);
+    if (http_parse_response(hdr, n, &resp) < 0 || resp.header_len == 0) {
+        // 헤더가 첫 chunk보다 길 때만 복사한다
+        n = 0;
+        for (buf_chunk_t *c = in->head; c != NULL && n < HTTP_MAX_HEADER; c = c->next) {
+            int k = MIN(c->len, HTTP_MAX_HEADER - n);
+            memcpy(copy + n, c->data, k);
+            n += k;
+        }
+        hdr = copy;
+        if (http_parse_response(hdr, n, &resp) < 0 || resp.header_len == 0) {
+            return 0;
+        }
+    }
+    long body_len = in->length - resp.header_len;
+    if (resp.status != 200 || resp.encoding != HTTP_ENCODING_IDENTITY || resp.no_store || resp.private ||
+        !compressible(resp.content_type) || body_len < CODEC_MIN_SIZE) {
+        return 0;
+    }
+
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, CODEC_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0; // windowBits + 16: zlib 대신 gzip 헤더와 트레일러
+    }
+    uLong bound = deflateBound(&zs, body_len);
+    char *body = Malloc(bound);
+    long skip = resp.header_len;
+    zs.next_out = (Bytef *)body;
+    zs.avail_out = bound;
+    for (buf_chunk_t *c = in->head; c != NULL; c = c->next) {
+        if (skip >= c->len) {
+            skip -= c->len; // 헤더만 든 chunk
+            continue;
+        }
+        zs.next_in = (Bytef *)c->data + skip;
+        zs.avail_in = c->len - skip;
+        skip = 0;
+        deflate(&zs, Z_NO_FLUSH); // 출력 버퍼가 deflateBound 크기라 한 번에 다 들어간다
+    }
+    int rc = deflate(&zs, Z_FINISH);
+    long zlen = zs.total_out;
+    deflateEnd(&zs);
+
+    int hlen = pack_header(hdr, resp.header_len, packed, sizeof(packed), zlen);
+    if (rc != Z_STREAM_END || (hlen + zlen) * 100 > (long)in->length * (100 - CODEC_MIN_SAVING)) {
+        Free(body);
+        return 0;
+    }
+    cache_fill_append(out, packed, hlen);
+    cache_fill_append(out, body, zlen);
+    Free(body);
+
+    __atomic_fetch_add(&compressed, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&raw_bytes, in->length, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&packed_bytes, out->length, __ATOMIC_RELAXED);
+    return 1;
+}
+
+/*
+ * send_header - Start an inflated response: the stored headers without
+ *     Content-Encoding and Content-Length. The connection is closed after
+ *     every response, so the end of the body needs no length.
+ */
+static int send_header(const char *hdr, int hlen, codec_sink_t sink, void *arg) {
+    char out[HTTP_MAX_HEADER];
+    const char *p = hdr, *end = hdr + hlen, *eol;
+    int len = 0;
+
+    while ((eol = memchr(p, '\n', end - p)) != NULL) {
+        int n = eol + 1 - p;
+        if (strncasecmp(p, "Content-Encoding:", 17) != 0 && strncasecmp(p, "Content-Length:", 15) != 0) {
+            memcpy(out + len, p, n);
+            len += n;
+        }
+        p = eol + 1;
+    }
+    __atomic_fetch_add(&inflated, 1, __ATOMIC_RELAXED);
+    return sink(arg, out, len);
+}
+
+/* Inflate n body bytes at in and pass the output to sink; returns -1 on error */
+static int inflate_piece(z_stream *zs, const char *in, int n, codec_sink_t sink, void *arg) {
+    char out[MAXBUF];
+
+    zs->next_in = (Bytef *)in;
+    zs->avail_in = n;
+    for (;;) {
+        zs->next_out = (Bytef *)out;
+        zs->avail_out = sizeof(out);
+        int rc = inflate(zs, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+            return -1; // 손상된 본문
+        }
+        int k = sizeof(out) - zs->avail_out;
+        if (k > 0 && sink(arg, out, k) < 0) {
+            return -1;
+        }
+        if (rc == Z_STREAM_END && zs->avail_in > 0) {
+            inflateReset(zs); // 여러 gzip 멤버가 이어진 본문
+            continue;
+        }
+        if (zs->avail_out != 0) {
+            return 0; // 입력을 모두 소비했다
+        }
+    }
+}
+
+/*
+ * codec_inflate - Send the pinned, gzip-encoded entry to sink as an
+ *     identity response, inflating the body chunk by chunk. Returns -1
+ *     if the sink failed or the body is corrupt.
+ */
+int codec_inflate(cache_entry_t *entry, codec_sink_t sink, void *arg) {
+    char hdr[HTTP_MAX_HEADER];
+    http_response_t resp;
+    z_stream zs;
+    int rc = 0;
+
+    if (entry->mapped != NULL) {
+        return codec_inflate_buf(entry->mapped, entry->content_length, sink, arg);
+    }
+    int n = cache_read(entry, 0, hdr, sizeof(hdr));
+    if (http_parse_response(hdr, n, &resp) < 0 || resp.header_len == 0 ||
+        send_header(hdr, resp.header_len, sink, arg) < 0) {
+        return -1;
+    }
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        return -1;
+    }
+    long skip = resp.header_len;
+    for (buf_chunk_t *c = entry->chunks; c != NULL && rc == 0; c = c->next) {
+        if (skip >= c->len) {
+            skip -= c->len;
+            continue;
+        }
+        rc = inflate_piece(&zs, c->data + skip, c->len - skip, sink, arg);
+        skip = 0;
+    }
+    inflateEnd(&zs);
+    return rc;
+}
+
+/* codec_inflate() for a gzip-encoded object held contiguously, in a snapshot or on disk */
+int codec_inflate_buf(const char *obj, int length, codec_sink_t sink, void *arg) {
+    http_response_t resp;
+    z_stream zs;
+
+    if (http_parse_response(obj, MIN(length, HTTP_MAX_HEADER), &resp) < 0 || resp.header_len == 0 ||
+        send_header(obj, resp.header_len, sink, arg) < 0) {
+        return -1;
+    }
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        return -1;
+    }
+    int rc = inflate_piece(&zs, obj + resp.header_len, length - resp.header_len, sink, arg);
+    inflateEnd(&zs);
+    return rc;
+}
+
+/* Sink that writes to the descriptor *arg */
+int codec_write_fd(void *arg, const char *buf, int n) {
+    return rio_writen(*(int *)arg, (void *)buf, n) < 0 ? -1 : 0;
+}
+
+/* Dump the compression counters with sio only */
+void codec_print_stats(void) {
+    Sio_puts("codec: compressed=");
+    Sio_putl(compressed);
+    Sio_puts(" raw_bytes=");
+    Sio_putl(raw_bytes);
+    Sio_puts(" packed_bytes=");
+    Sio_putl(packed_bytes);
+    Sio_puts(" inflated=");
+    Sio_putl(inflated);
+    Sio_puts("\n");
+}
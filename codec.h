@@ -0,0 +1,28 @@
+/*
+ * codec.h - gzip compression of cached text objects
+ *
+ * Text-like responses are compressed once, when their flight completes,
+ * and stored with Content-Encoding: gzip, so the same memory holds
+ * several times more of them. Clients that accept gzip are sent the
+ * stored bytes as they are; for the others the body is inflated on the
+ * fly while it is written.
+ */
+#ifndef __CODEC_H__
+#define __CODEC_H__
+
+#include "cache.h"
+
+#define CODEC_MIN_SIZE 256        /* Smaller bodies are stored as they are */
+#define CODEC_LEVEL 1             /* zlib level: the fastest one gets most of the ratio on text */
+#define CODEC_MIN_SAVING 10       /* Percent of the object that compression must save */
+
+/* Receives inflated bytes; returns -1 to stop */
+typedef int (*codec_sink_t)(void *arg, const char *buf, int n);
+
+int codec_compress(const cache_fill_t *in, cache_fill_t *out);
+int codec_inflate(cache_entry_t *entry, codec_sink_t sink, void *arg);
+int codec_inflate_buf(const char *obj, int length, codec_sink_t sink, void *arg);
+int codec_write_fd(void *arg, const char *buf, int n);
+void codec_print_stats(void);
+
+#endif /* __CODEC_H__ */
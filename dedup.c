@@ -0,0 +1,183 @@
+#include <zlib.h>
+#include "csapp.h"
+#include "cache.h"
+#include "dedup.h"
+#include "mem.h"
+
+static blob_t *table[DEDUP_BUCKETS]; /* Shared bodies keyed by CRC-32 */
+static sem_t table_mutex;            /* Protects table[], refcnt and the byte counters */
+static long blobs, shared, logical_bytes, stored_bytes;
+
+void dedup_init(void) {
+    Sem_init(&table_mutex, 0, 1);
+    mem_overhead_charge(sizeof(table));
+}
+
+/*
+ * split_body - Cut the fill's chain after its header_len header bytes.
+ *     The header stays in fill, its last chunk trimmed; the body is
+ *     returned as a chain that starts at a chunk boundary. At most one
+ *     partly used chunk is copied.
+ */
+static buf_chunk_t *split_body(cache_fill_t *fill, int header_len) {
+    buf_chunk_t **pp = &fill->head, *c, *body;
+    long off = header_len;
+
+    while (off > (c = *pp)->len) {
+        off -= c->len;
+        pp = &c->next;
+    }
+    if (off == c->len) {
+        body = c->next; // 헤더가 chunk 경계에서 끝난다
+    } else {
+        body = bufpool_get();
+        body->len = c->len - off;
+        memcpy(body->data, c->data + off, body->len);
+        body->next = c->next;
+        if (body->next == NULL) {
+            body = bufpool_trim(body);
+        }
+        c->len = off;
+    }
+    c->next = NULL;
+    *pp = fill->tail = bufpool_trim(c);
+    return body;
+}
+
+/* Compare two body chains that both hold n bytes */
+static int chain_equal(buf_chunk_t *a, buf_chunk_t *b, long n) {
+    int ao = 0, bo = 0;
+
+    while (n > 0) {
+        if (ao == a->len) {
+            a = a->next;
+            ao = 0;
+        }
+        if (bo == b->len) {
+            b = b->next;
+            bo = 0;
+        }
+        int k = MIN(a->len - ao, b->len - bo);
+        if (memcmp(a->data + ao, b->data + bo, k) != 0) {
+            return 0;
+        }
+        ao += k;
+        bo += k;
+        n -= k;
+    }
+    return 1;
+}
+
+/*
+ * dedup_attach - Store the body of a completed fill once. The fill's
+ *     chain becomes its own header chunks followed by the body of a blob:
+ *     an existing one holding the same bytes, whose copy in the fill goes
+ *     back to the pool, or a new one made of the fill's body chunks.
+ *     Sets *blob (NULL for bodies under DEDUP_MIN_SIZE, which are left
+ *     alone) and returns how many body bytes were already charged by
+ *     another entry; 0 means the caller's entry owns the charge.
+ */
+long dedup_attach(cache_fill_t *fill, int header_len, blob_t **blob) {
+    long length = fill->length - header_len;
+    unsigned long crc = crc32(0L, Z_NULL, 0);
+    blob_t *b;
+
+    *blob = NULL;
+    if (length < DEDUP_MIN_SIZE) {
+        return 0;
+    }
+    buf_chunk_t *body = split_body(fill, header_len);
+    for (buf_chunk_t *c = body; c != NULL; c = c->next) {
+        crc = crc32(crc, (Bytef *)c->data, c->len);
+    }
+
+    P(&table_mutex);
+    blob_t **bucket = &table[crc % DEDUP_BUCKETS];
+    for (b = *bucket; b != NULL; b = b->hnext) {
+        if (b->crc == crc && b->length == length && chain_equal(b->chunks, body, length)) {
+            break;
+        }
+    }
+    logical_bytes += length;
+    if (b != NULL) {
+        int adopted = !b->charged; // 주인 없던 본문이면 이 항목이 떠맡는다
+        b->refcnt++;
+        b->charged = 1;
+        shared++;
+        V(&table_mutex);
+        bufpool_put_chain(body); // 같은 본문이 이미 있으므로 새 사본은 반납
+        fill->tail->next = b->chunks;
+        *blob = b;
+        return adopted ? 0 : length;
+    }
+    b = Malloc(sizeof(blob_t));
+    mem_overhead_charge(sizeof(blob_t)); // 본문 chunk는 slab 페이지에 있어 accountant가 따로 센다
+    b->crc = crc;
+    b->length = length;
+    b->chunks = body;
+    b->refcnt = 1;
+    b->charged = 1;
+    b->hnext = *bucket;
+    *bucket = b;
+    blobs++;
+    stored_bytes += length;
+    V(&table_mutex);
+
+    fill->tail->next = body;
+    *blob = b;
+    return 0;
+}
+
+/*
+ * dedup_detach - Free an entry's chain that ends in blob: its own header
+ *     chunks go back to the pool and the blob loses a reference; the last
+ *     one frees the body. If the entry was the owner that charged the
+ *     body (owner), a body still shared is charged to no shard until
+ *     another entry takes it over.
+ */
+void dedup_detach(buf_chunk_t *chunks, blob_t *blob, int owner) {
+    buf_chunk_t *c = chunks;
+
+    while (c->next != blob->chunks) {
+        c = c->next;
+    }
+    c->next = NULL; // 공유 본문 앞에서 체인을 끊는다
+    bufpool_put_chain(chunks);
+
+    P(&table_mutex);
+    logical_bytes -= blob->length;
+    if (--blob->refcnt > 0) {
+        if (owner) {
+            blob->charged = 0; // 남은 항목들은 본문을 세지 않는다
+        }
+        V(&table_mutex);
+        return;
+    }
+    blob_t **pp = &table[blob->crc % DEDUP_BUCKETS];
+    while (*pp != blob) {
+        pp = &(*pp)->hnext;
+    }
+    *pp = blob->hnext;
+    blobs--;
+    stored_bytes -= blob->length;
+    V(&table_mutex);
+
+    mem_overhead_charge(-(long)sizeof(blob_t));
+    bufpool_put_chain(blob->chunks);
+    Free(blob);
+}
+
+/* Dump the dedup counters with sio only; ratio is logical bytes per stored byte, in percent */
+void dedup_print_stats(void) {
+    Sio_puts("dedup: blobs=");
+    Sio_putl(blobs);
+    Sio_puts(" shared=");
+    Sio_putl(shared);
+    Sio_puts(" logical_bytes=");
+    Sio_putl(logical_bytes);
+    Sio_puts(" stored_bytes=");
+    Sio_putl(stored_bytes);
+    Sio_puts(" ratio=");
+    Sio_putl(stored_bytes > 0 ? logical_bytes * 100 / stored_bytes : 100);
+    Sio_puts("%\n");
+}
@@ -0,0 +1,40 @@
+/*
+ * dedup.h - content-addressed sharing of cached bodies
+ *
+ * The same body often lives under many URIs (cache-busting query
+ * strings, mirrors). Such bodies are stored once, in a refcounted blob
+ * found by CRC-32 and length and confirmed byte for byte. An entry's
+ * chunk chain starts with its own header chunks and the last of them
+ * links into the blob's body chain, so everything that walks a chain
+ * still reads the whole response.
+ *
+ * A shared body is charged to the cache budget by the entry that stored
+ * it first; later entries only pay for their headers. When that entry
+ * goes while others still share the body, no shard pays for it until an
+ * entry storing the same bytes takes it over or the blob is freed. The
+ * memory accountant still sees it: it counts the slab pages the body
+ * chunks live on, plus the table and blob structs as heap overhead.
+ */
+#ifndef __DEDUP_H__
+#define __DEDUP_H__
+
+#include "cache.h"
+
+#define DEDUP_BUCKETS 4096
+#define DEDUP_MIN_SIZE 1024       /* Smaller bodies are not worth the lookup */
+
+typedef struct blob {
+    unsigned long crc;        /* CRC-32 of the body */
+    long length;
+    buf_chunk_t *chunks;      /* Body chain, starting at its first byte */
+    int refcnt;               /* Entries sharing it; protected by the table lock */
+    int charged;              /* An entry charges it to its shard */
+    struct blob *hnext;
+} blob_t;
+
+void dedup_init(void);
+long dedup_attach(cache_fill_t *fill, int header_len, blob_t **blob);
+void dedup_detach(buf_chunk_t *chunks, blob_t *blob, int owner);
+void dedup_print_stats(void);
+
+#endif /* __DEDUP_H__ */
@@ -0,0 +1,424 @@
+#include <sys/sendfile.h>
+#include "csapp.h"
+#include "cache.h"
+#include "disk.h"
+#include "codec.h"
+#include "mem.h"
+
+static int enabled;                 /* Set once disk_init() succeeds */
+static disk_segment_t *segs;
+static int nsegs;
+static int cur_seg;                 /* Segment the writer appends to */
+static long cur_off;                /* Next free byte in cur_seg */
+static disk_obj_t **buckets;        /* URI hash index of everything on disk */
+static int nbuckets;
+static purge_index_t pindex;        /* URI radix tree and surrogate keys of the newest versions */
+static sem_t disk_mutex;            /* Protects the indexes, segment lists and readers */
+static long obj_bytes;              /* disk_obj_t items and their URIs */
+static long index_charged;          /* Index memory last reported to the accountant */
+
+/* Demotion queue between evicting threads and the writer */
+static struct cache_entry *queue[DISK_QUEUE_SIZE];
+static long qgen[DISK_QUEUE_SIZE];  /* cache_purge_gen() of each queued entry when it left RAM */
+static int qfront, qrear;
+static sem_t qmutex, qslots, qitems;
+
+static long hits, misses, writes, drops, recycled, bytes, purged;
+
+static void *disk_writer(void *vargp);
+
+/* Report how much the indexes grew or shrank to the memory accountant; caller holds disk_mutex */
+static void index_account(void) {
+    long now = nbuckets * sizeof(disk_obj_t *) + obj_bytes + pindex.bytes;
+
+    mem_overhead_charge(now - index_charged);
+    index_charged = now;
+}
+
+/*
+ * disk_init - Create nsegs preallocated segment files of DISK_SEGMENT_SIZE
+ *     in dir and map them. Old contents are discarded. Returns -1 (and
+ *     leaves the tier disabled) if the files cannot be created or the
+ *     space cannot be reserved.
+ */
+int disk_init(const char *dir, long size) {
+    char path[MAXLINE];
+    pthread_t tid;
+
+    nsegs = MAX(size / DISK_SEGMENT_SIZE, DISK_MIN_SEGMENTS);
+    segs = Calloc(nsegs, sizeof(disk_segment_t));
+    for (int i = 0; i < nsegs; i++) {
+        snprintf(path, sizeof(path), "%s/segment.%03d", dir, i);
+        if ((segs[i].fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0) {
+            fprintf(stderr, "disk: %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        // 미리 공간을 확보해 두어야 mmap 쓰기 중 ENOSPC(SIGBUS)가 나지 않는다
+        int rc = posix_fallocate(segs[i].fd, 0, DISK_SEGMENT_SIZE);
+        if (rc != 0) {
+            fprintf(stderr, "disk: %s: %s\n", path, strerror(rc));
+            return -1;
+        }
+        segs[i].map = Mmap(NULL, DISK_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, segs[i].fd, 0);
+    }
+
+    nbuckets = 64;
+    while ((long)nbuckets < (long)nsegs * DISK_SEGMENT_SIZE / CACHE_AVG_OBJECT_SIZE) {
+        nbuckets <<= 1;
+    }
+    buckets = Calloc(nbuckets, sizeof(disk_obj_t *));
+    purge_index_init(&pindex);
+    index_account();
+    cur_seg = 0;
+    cur_off = 0;
+    Sem_init(&disk_mutex, 0, 1);
+    qfront = qrear = 0;
+    Sem_init(&qmutex, 0, 1);
+    Sem_init(&qslots, 0, DISK_QUEUE_SIZE);
+    Sem_init(&qitems, 0, 0);
+    Pthread_create(&tid, NULL, disk_writer, NULL);
+    enabled = 1;
+    return 0;
+}
+
+/* Find uri in the index; caller holds disk_mutex */
+static disk_obj_t *obj_find(const char *uri, unsigned long hash) {
+    for (disk_obj_t *o = buckets[hash & (nbuckets - 1)]; o != NULL; o = o->hnext) {
+        if (o->hash == hash && strcmp(o->uri, uri) == 0) {
+            return o;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * segment_recycle - Forget every object stored in segment s so the writer
+ *     can overwrite it, then wait for hits still sending from it. New
+ *     lookups can no longer find it, so the wait is short.
+ *
+ *     sendfile() returns as soon as the page cache pages are queued on
+ *     the socket, not when they are sent, so the segment must not be
+ *     overwritten in place. Truncating and reallocating the file gives
+ *     the writer fresh pages and leaves queued ones untouched. Caller
+ *     holds disk_mutex; it is dropped while waiting.
+ */
+static void segment_recycle(int s) {
+    disk_obj_t *o = segs[s].objs;
+
+    while (o != NULL) {
+        disk_obj_t *snext = o->snext;
+        disk_obj_t **pp = &buckets[o->hash & (nbuckets - 1)];
+        while (*pp != o) {
+            pp = &(*pp)->hnext;
+        }
+        *pp = o->hnext;
+        purge_index_remove(&pindex, &o->purge);
+        bytes -= o->length;
+        obj_bytes -= sizeof(disk_obj_t) + strlen(o->uri) + 1;
+        Free(o->uri);
+        Free(o);
+        o = snext;
+    }
+    segs[s].objs = NULL;
+    index_account();
+    recycled++;
+    while (segs[s].readers > 0) {
+        V(&disk_mutex);
+        usleep(1000);
+        P(&disk_mutex);
+    }
+    // 아무도 이 세그먼트를 읽지 않으므로 잠시 매핑 범위가 비어도 안전하다
+    if (ftruncate(segs[s].fd, 0) < 0 || posix_fallocate(segs[s].fd, 0, DISK_SEGMENT_SIZE) != 0) {
+        app_error("disk: cannot reallocate segment");
+    }
+}
+
+/*
+ * disk_store - Append one evicted entry to the log unless it is already
+ *     on disk. gen is its shard's purge generation at demotion; if a
+ *     PURGE has run since, the entry may be a purged one and is dropped.
+ */
+static void disk_store(cache_entry_t *e, long gen) {
+    int urilen = strlen(e->uri);
+    long need = sizeof(disk_record_t) + urilen + e->content_length;
+    int s;
+    long off;
+
+    P(&disk_mutex);
+    if (cache_purge_gen(e->hash) != gen) {
+        V(&disk_mutex); // 대기열에 있는 동안 PURGE가 지나갔다
+        return;
+    }
+    disk_obj_t *old = obj_find(e->uri, e->hash);
+    if (old != NULL && old->expires == e->expires) {
+        V(&disk_mutex); // 디스크에서 승격된 항목은 이미 기록되어 있다
+        return;
+    }
+    if (cur_off + need > DISK_SEGMENT_SIZE) {
+        cur_seg = (cur_seg + 1) % nsegs;
+        cur_off = 0;
+        segment_recycle(cur_seg); // 가장 오래된 세그먼트를 덮어쓴다
+    }
+    s = cur_seg;
+    off = cur_off;
+    cur_off += need;
+    V(&disk_mutex);
+
+    /* Only this thread writes, so the reserved range needs no lock */
+    char *p = segs[s].map + off;
+    disk_record_t rec = { DISK_RECORD_MAGIC, urilen, e->content_length, e->hash, e->expires };
+    memcpy(p, &rec, sizeof(rec));
+    p += sizeof(rec);
+    memcpy(p, e->uri, urilen);
+    p += urilen;
+    if (e->mapped != NULL) {
+        memcpy(p, e->mapped, e->content_length); // 스냅샷에서 복원된 항목
+    }
+    for (buf_chunk_t *c = e->chunks; c != NULL; c = c->next) {
+        memcpy(p, c->data, c->len);
+        p += c->len;
+    }
+
+    disk_obj_t *o = Malloc(sizeof(disk_obj_t));
+    o->hash = e->hash;
+    o->seg = s;
+    o->offset = off + sizeof(rec) + urilen;
+    o->length = e->content_length;
+    o->expires = e->expires;
+    o->uri = Malloc(urilen + 1);
+    memcpy(o->uri, e->uri, urilen + 1);
+    o->purge.rnode = NULL;
+    o->purge.tags = NULL;
+    char keys[MAXLINE];
+    int tagged = purge_keys(segs[s].map + o->offset, o->length, keys, sizeof(keys)); // 잠금 밖에서 헤더를 읽는다
+
+    P(&disk_mutex);
+    if (cache_purge_gen(e->hash) != gen) {
+        V(&disk_mutex); // 기록하는 동안 PURGE가 지나갔다: 색인하지 않으면 재활용 때 자리만 사라진다
+        Free(o->uri);
+        Free(o);
+        return;
+    }
+    // 버킷 앞에 넣으므로 새 버전이 예전 버전을 가린다 (예전 것은 재활용 때 사라짐)
+    if ((old = obj_find(o->uri, o->hash)) != NULL) {
+        purge_index_remove(&pindex, &old->purge);
+    }
+    purge_index_add(&pindex, &o->purge, o, o->uri, tagged ? keys : NULL);
+    o->hnext = buckets[o->hash & (nbuckets - 1)];
+    buckets[o->hash & (nbuckets - 1)] = o;
+    o->snext = segs[s].objs;
+    segs[s].objs = o;
+    writes++;
+    bytes += o->length;
+    obj_bytes += sizeof(disk_obj_t) + urilen + 1;
+    index_account();
+    V(&disk_mutex);
+}
+
+/* Background writer: drain the demotion queue into the log */
+static void *disk_writer(void *vargp) {
+    Pthread_detach(pthread_self());
+    for (;;) {
+        P(&qitems);
+        P(&qmutex);
+        cache_entry_t *e = queue[qfront];
+        long gen = qgen[qfront];
+        qfront = (qfront + 1) % DISK_QUEUE_SIZE;
+        V(&qmutex);
+        V(&qslots);
+        disk_store(e, gen);
+        cache_release(e);
+    }
+    return NULL;
+}
+
+/*
+ * disk_demote - Queue an entry that is leaving RAM for the disk tier.
+ *     Called with a shard lock held, so it never blocks: when the writer
+ *     is behind, the entry is simply dropped.
+ */
+void disk_demote(cache_entry_t *entry) {
+    if (!enabled) {
+        return;
+    }
+    if (sem_trywait(&qslots) != 0) {
+        __atomic_fetch_add(&drops, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_fetch_add(&entry->refcnt, 1, __ATOMIC_RELAXED); // writer가 쓰는 동안 body 유지
+    P(&qmutex);
+    queue[qrear] = entry;
+    qgen[qrear] = cache_purge_gen(entry->hash);
+    qrear = (qrear + 1) % DISK_QUEUE_SIZE;
+    V(&qmutex);
+    V(&qitems);
+}
+
+/*
+ * disk_serve - Send uri from the disk tier to fd with sendfile() and
+ *     promote it back into the RAM cache. A gzip-encoded object goes to a
+ *     client without gzip inflated from the mapping instead. Returns 1 if
+ *     it was served, 0 if it is not on disk or has expired and -1 if the
+ *     client went away.
+ */
+int disk_serve(int fd, const char *uri, unsigned long hash, int gzip_ok) {
+    disk_obj_t *o;
+    int s, length, rc = 1;
+    long offset, expires, gen;
+
+    if (!enabled) {
+        return 0;
+    }
+    gen = cache_purge_gen(hash); // 찾기 전에 읽어 두면 그 뒤의 PURGE가 승격을 막는다
+    P(&disk_mutex);
+    if ((o = obj_find(uri, hash)) == NULL || (o->expires != 0 && o->expires <= time(NULL))) {
+        misses++;
+        V(&disk_mutex);
+        return 0;
+    }
+    s = o->seg;
+    offset = o->offset;
+    length = o->length;
+    expires = o->expires;
+    segs[s].readers++; // 전송이 끝날 때까지 세그먼트 재활용을 막는다
+    hits++;
+    V(&disk_mutex);
+
+    http_response_t resp;
+    off_t pos = offset;
+    long left = length;
+    if (!gzip_ok && http_parse_response(segs[s].map + offset, MIN(length, HTTP_MAX_HEADER), &resp) == 0 &&
+        resp.encoding == HTTP_ENCODING_GZIP) {
+        rc = codec_inflate_buf(segs[s].map + offset, length, codec_write_fd, &fd) < 0 ? -1 : 1;
+        left = 0;
+    }
+    while (left > 0) {
+        ssize_t n = sendfile(fd, segs[s].fd, &pos, left);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            rc = -1;
+            break;
+        }
+        left -= n;
+    }
+
+    if (rc > 0) {
+        // 매핑에서 바로 채워 RAM으로 승격 (남을지는 admission이 결정)
+        cache_fill_t fill;
+        cache_fill_init(&fill);
+        cache_fill_append(&fill, segs[s].map + offset, length);
+        fill.expires = expires; // 처음 저장할 때 정한 만료 시각을 그대로 유지
+        fill.gen = gen;
+        cache_insert(uri, hash, &fill);
+    }
+
+    P(&disk_mutex);
+    segs[s].readers--;
+    V(&disk_mutex);
+    return rc;
+}
+
+/* Objects found in the purge index, expired once the walk is over */
+typedef struct {
+    disk_obj_t **v;
+    int n;
+    int cap;
+} purge_set_t;
+
+static void purge_collect(void *o, void *arg) {
+    purge_set_t *set = arg;
+
+    if (set->n == set->cap) {
+        set->cap = set->cap > 0 ? set->cap * 2 : 64;
+        set->v = Realloc(set->v, set->cap * sizeof(disk_obj_t *));
+    }
+    set->v[set->n++] = o;
+}
+
+/*
+ * purge_matches - Expire every object the index lookup fn finds for key.
+ *     They leave the purge index at once and stay on disk as misses until
+ *     their segment is recycled. Returns how many were still live.
+ */
+static long purge_matches(void (*fn)(purge_index_t *, const char *, purge_visit_t, void *), const char *key) {
+    purge_set_t set = { NULL, 0, 0 };
+    long now = time(NULL), n = 0;
+
+    if (!enabled) {
+        return 0;
+    }
+    P(&disk_mutex);
+    fn(&pindex, key, purge_collect, &set);
+    for (int i = 0; i < set.n; i++) {
+        disk_obj_t *o = set.v[i];
+        if (o->expires == 0 || o->expires > now) {
+            n++;
+        }
+        o->expires = 1; // 1970년에 만료된 것으로 표시
+        purge_index_remove(&pindex, &o->purge);
+    }
+    purged += n;
+    index_account();
+    V(&disk_mutex);
+    Free(set.v);
+    return n;
+}
+
+/* Expire every stored version of uri; returns how many were live */
+long disk_purge(const char *uri, unsigned long hash) {
+    long now = time(NULL), n = 0;
+
+    if (!enabled) {
+        return 0;
+    }
+    P(&disk_mutex);
+    for (disk_obj_t *o = buckets[hash & (nbuckets - 1)]; o != NULL; o = o->hnext) {
+        if (o->hash == hash && strcmp(o->uri, uri) == 0) {
+            if (o->expires == 0 || o->expires > now) {
+                n++;
+            }
+            o->expires = 1;
+            purge_index_remove(&pindex, &o->purge);
+        }
+    }
+    purged += n;
+    index_account();
+    V(&disk_mutex);
+    return n;
+}
+
+/* Expire every object on disk whose URI starts with prefix */
+long disk_purge_prefix(const char *prefix) {
+    return purge_matches(purge_index_prefix, prefix);
+}
+
+/* Expire every object on disk whose Surrogate-Key lists tag */
+long disk_purge_tag(const char *tag) {
+    return purge_matches(purge_index_tag, tag);
+}
+
+/* Dump the disk tier counters with sio only, like cache_print_stats() */
+void disk_print_stats(void) {
+    if (!enabled) {
+        return;
+    }
+    Sio_puts("disk: segments=");
+    Sio_putl(nsegs);
+    Sio_puts(" hits=");
+    Sio_putl(hits);
+    Sio_puts(" misses=");
+    Sio_putl(misses);
+    Sio_puts(" writes=");
+    Sio_putl(writes);
+    Sio_puts(" drops=");
+    Sio_putl(drops);
+    Sio_puts(" recycled=");
+    Sio_putl(recycled);
+    Sio_puts(" bytes=");
+    Sio_putl(bytes);
+    Sio_puts(" purged=");
+    Sio_putl(purged);
+    Sio_puts("\n");
+}
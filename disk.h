@@ -0,0 +1,64 @@
+/*
+ * disk.h - memory-mapped, log-structured second cache tier
+ *
+ * Objects evicted from RAM are queued to a background writer, which
+ * appends them to a ring of preallocated, mmap()ed segment files. When
+ * the ring wraps, the oldest segment is recycled and every object in it
+ * is forgotten. Disk hits are sent with sendfile() and promoted back
+ * into the RAM cache, where admission decides whether they stay. The
+ * newest version of every object is also in a purge index (purge.h), so
+ * purges by prefix or tag touch only the objects they match.
+ */
+#ifndef __DISK_H__
+#define __DISK_H__
+
+#include "purge.h"
+
+#ifndef DISK_SEGMENT_SIZE
+#define DISK_SEGMENT_SIZE (64L * 1024 * 1024) /* One preallocated file */
+#endif
+#define DISK_DEFAULT_MB 1024                  /* Tier size when -D is not given */
+#define DISK_MIN_SEGMENTS 2
+#define DISK_QUEUE_SIZE 1024                  /* Demotions waiting for the writer */
+#define DISK_RECORD_MAGIC 0x50584443U         /* "PXDC" */
+
+struct cache_entry;
+
+/* Written before every object so a segment can be scanned without the index */
+typedef struct {
+    unsigned int magic;
+    int urilen;               /* URI bytes that follow, without the NUL */
+    int length;               /* Object bytes that follow the URI */
+    unsigned long hash;
+    long expires;             /* Absolute expiry time, 0 = never */
+} disk_record_t;
+
+/* An object's place on disk, kept in the in-memory index */
+typedef struct disk_obj {
+    unsigned long hash;
+    int seg;                  /* Segment holding the object */
+    long offset;              /* Offset of the object bytes inside the segment */
+    int length;
+    long expires;             /* Expired objects are misses until the segment is recycled */
+    char *uri;
+    struct disk_obj *hnext;   /* 같은 해시 버킷의 다음 항목 */
+    struct disk_obj *snext;   /* 같은 세그먼트에 있는 다음 항목 (재활용 시 일괄 삭제) */
+    purge_links_t purge;      /* Its place in the purge index; only the newest version is there */
+} disk_obj_t;
+
+typedef struct {
+    int fd;
+    char *map;                /* The whole segment, MAP_SHARED */
+    int readers;              /* Hits currently sending from this segment */
+    disk_obj_t *objs;         /* Objects stored in this segment */
+} disk_segment_t;
+
+int disk_init(const char *dir, long size);
+void disk_demote(struct cache_entry *entry);
+int disk_serve(int fd, const char *uri, unsigned long hash, int gzip_ok);
+long disk_purge(const char *uri, unsigned long hash);
+long disk_purge_prefix(const char *prefix);
+long disk_purge_tag(const char *tag);
+void disk_print_stats(void);
+
+#endif /* __DISK_H__ */
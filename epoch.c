@@ -0,0 +1,111 @@
+#include "csapp.h"
+#include "epoch.h"
+
+/*
+ * Each thread owns one slot. A slot holds (epoch << 1) | 1 while the
+ * thread is inside a critical section and 0 otherwise, so a single
+ * store publishes both values.
+ */
+typedef struct {
+    unsigned long state;
+    char pad[64 - sizeof(unsigned long)]; /* Keep slots on their own cache line */
+} epoch_slot_t;
+
+static epoch_slot_t slots[EPOCH_MAX_THREADS];
+static int nslots;                  /* Slots handed out so far */
+static unsigned long global_epoch;
+static epoch_node_t *limbo[3];      /* Nodes retired in epoch e live in limbo[e % 3] */
+static sem_t limbo_mutex;           /* Protects limbo[] and epoch advancement */
+
+static __thread int my_slot = -1;
+
+void epoch_init(void) {
+    global_epoch = 0;
+    nslots = 0;
+    limbo[0] = limbo[1] = limbo[2] = NULL;
+    Sem_init(&limbo_mutex, 0, 1);
+}
+
+/* Claim a slot for the calling thread on its first critical section */
+static epoch_slot_t *my_epoch_slot(void) {
+    if (my_slot < 0) {
+        my_slot = __atomic_fetch_add(&nslots, 1, __ATOMIC_RELAXED);
+        if (my_slot >= EPOCH_MAX_THREADS) {
+            app_error("epoch: too many threads");
+        }
+    }
+    return &slots[my_slot];
+}
+
+/* Begin a read-side critical section; nodes seen inside stay valid until epoch_exit() */
+void epoch_enter(void) {
+    epoch_slot_t *s = my_epoch_slot();
+    unsigned long e = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&s->state, (e << 1) | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST); /* Announce before reading any shared pointer */
+}
+
+/* End a read-side critical section */
+void epoch_exit(void) {
+    __atomic_store_n(&slots[my_slot].state, 0, __ATOMIC_RELEASE);
+}
+
+/* Free every node in a limbo list */
+static void free_limbo(epoch_node_t *l) {
+    while (l != NULL) {
+        epoch_node_t *next = l->next; /* free_fn may release the node itself */
+        l->free_fn(l->ptr);
+        l = next;
+    }
+}
+
+/*
+ * try_advance - Move the global epoch forward if every active thread has
+ *     observed it. Nodes retired two epochs ago can no longer be reached
+ *     by anyone and are freed. Caller holds limbo_mutex.
+ */
+static void try_advance(void) {
+    unsigned long e = global_epoch;
+    int n = __atomic_load_n(&nslots, __ATOMIC_ACQUIRE);
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < n && i < EPOCH_MAX_THREADS; i++) {
+        unsigned long st = __atomic_load_n(&slots[i].state, __ATOMIC_ACQUIRE);
+        if ((st & 1) && (st >> 1) != e) {
+            return; // 아직 이전 epoch에 머무는 reader가 있다
+        }
+    }
+    __atomic_store_n(&global_epoch, e + 1, __ATOMIC_RELEASE);
+
+    epoch_node_t *expired = limbo[(e + 1) % 3]; /* Retired in epoch e - 2 */
+    limbo[(e + 1) % 3] = NULL;
+    free_limbo(expired);
+}
+
+/* Schedule ptr to be released with free_fn once no reader can still see it.
+   node is storage inside the object itself and must stay untouched until then. */
+void epoch_retire(epoch_node_t *node, void *ptr, epoch_free_fn free_fn) {
+    node->ptr = ptr;
+    node->free_fn = free_fn;
+
+    P(&limbo_mutex);
+    node->next = limbo[global_epoch % 3];
+    limbo[global_epoch % 3] = node;
+    try_advance();
+    V(&limbo_mutex);
+}
+
+/*
+ * epoch_reclaim - Advance past readers that have all left and free what
+ *     is left in limbo. epoch_retire() only advances when something new
+ *     is retired, so without this a quiet process would keep the last
+ *     retired nodes (old indexes, evicted entries and their chunks)
+ *     forever. Called once a second by the cache's sweeper.
+ */
+void epoch_reclaim(void) {
+    P(&limbo_mutex);
+    for (int i = 0; i < 3 && (limbo[0] != NULL || limbo[1] != NULL || limbo[2] != NULL); i++) {
+        try_advance(); // 세 번 나아가면 모든 limbo 목록이 두 epoch 이상 지난다
+    }
+    V(&limbo_mutex);
+}
@@ -0,0 +1,30 @@
+/*
+ * epoch.h - epoch-based reclamation for lock-free readers
+ *
+ * Readers bracket every traversal of a shared structure with
+ * epoch_enter()/epoch_exit() and never block. Writers unlink a node
+ * under their own lock and hand it to epoch_retire(); the node is freed
+ * only after every thread that could still hold a reference to it has
+ * left its critical section.
+ */
+#ifndef __EPOCH_H__
+#define __EPOCH_H__
+
+#define EPOCH_MAX_THREADS 256 /* Threads that may ever call epoch_enter() */
+
+typedef void (*epoch_free_fn)(void *ptr);
+
+/* Embedded in every retirable object so retiring never allocates */
+typedef struct epoch_node {
+    struct epoch_node *next;
+    void *ptr;
+    epoch_free_fn free_fn;
+} epoch_node_t;
+
+void epoch_init(void);
+void epoch_enter(void);
+void epoch_exit(void);
+void epoch_retire(epoch_node_t *node, void *ptr, epoch_free_fn free_fn);
+void epoch_reclaim(void);
+
+#endif /* __EPOCH_H__ */
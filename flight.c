@@ -0,0 +1,405 @@
+#include <limits.h>
+#include "csapp.h"
+#include "cache.h"
+#include "flight.h"
+#include "codec.h"
+#include "mem.h"
+
+/* A follower's place in the chain, on its own stack */
+typedef struct flight_reader {
+    long seq;                 /* Index of the chunk it is sending */
+    int fd;
+    int cut;                  /* Fell FLIGHT_MAX_BUFFER behind; its client is shut down */
+    struct flight_reader *next;
+} flight_reader_t;
+
+static flight_t *table[FLIGHT_BUCKETS]; /* In-flight misses keyed by URI hash */
+static sem_t table_mutex;               /* Protects table[], refcnt and unbuffered */
+static long leaders, followers;
+
+void flight_init(void) {
+    Sem_init(&table_mutex, 0, 1);
+}
+
+/*
+ * flight_begin - Join the flight for uri, or start one. Sets *leader when
+ *     the caller must fetch the origin itself. gzip tells whether the
+ *     caller's client accepts gzip: a leader that has it asks the origin
+ *     for gzip, and only such callers may join its flight, since the
+ *     bytes are streamed as they came. A leader's request headers hdrs
+ *     (or NULL) are kept, so a response that turns out to vary by
+ *     request header is cached as this request's variant. Returns NULL if the URI
+ *     was cached after the caller's lookup (a flight that just landed);
+ *     the caller should look it up again.
+ */
+flight_t *flight_begin(const char *uri, unsigned long hash, int gzip, const char *hdrs, int *leader) {
+    flight_t **bucket = &table[hash % FLIGHT_BUCKETS];
+    flight_t *f;
+
+    P(&table_mutex);
+    for (f = *bucket; f != NULL; f = f->hnext) {
+        if (f->hash == hash && strcmp(f->uri, uri) == 0 && !f->unbuffered && (gzip || !f->gzip)) {
+            f->refcnt++;
+            f->joined++;
+            followers++;
+            V(&table_mutex);
+            *leader = 0;
+            return f;
+        }
+    }
+    // 마지막 참여자가 잠금을 쥔 채 캐시에 넣고 떠났을 수 있다
+    if (cache_contains(uri, hash)) {
+        V(&table_mutex);
+        return NULL;
+    }
+    f = Malloc(sizeof(flight_t));
+    f->hash = hash;
+    f->uri = Malloc(strlen(uri) + 1);
+    strcpy(f->uri, uri);
+    f->head = f->tail = NULL;
+    f->length = 0;
+    f->charged = sizeof(flight_t) + strlen(uri) + 1;
+    f->state = FLIGHT_FILLING;
+    f->unbuffered = 0;
+    f->gzip = gzip;
+    f->refcnt = 1;
+    f->joined = f->started = f->cutting = 0;
+    f->readers = NULL;
+    f->head_seq = 0;
+    f->gen = cache_purge_gen(hash);
+    f->hdrs = NULL;
+    if (hdrs != NULL) {
+        f->hdrs = Malloc(strlen(hdrs) + 1);
+        strcpy(f->hdrs, hdrs);
+        f->charged += strlen(hdrs) + 1;
+    }
+    mem_flight_charge(f->charged);
+    mem_overhead_charge(f->charged); // 지금까지는 힙에 있는 구조체와 문자열뿐이다
+    cache_fill_init(&f->packed);
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->more, NULL);
+    f->hnext = *bucket;
+    *bucket = f;
+    leaders++;
+    V(&table_mutex);
+    *leader = 1;
+    return f;
+}
+
+/*
+ * flight_trim - Free the chunks at the head of an unbuffered flight that
+ *     every follower has sent. A follower whose unsent bytes exceed
+ *     FLIGHT_MAX_BUFFER is cut off: its socket is shut down so a stalled
+ *     write returns, and its chunks go once it has left. With no
+ *     follower left the whole chain goes and nothing more is buffered.
+ *     Caller holds f->lock.
+ */
+static void flight_trim(flight_t *f) {
+    for (;;) {
+        flight_reader_t *slow = NULL;
+        long min = LONG_MAX, live = 0;
+
+        if (f->started < f->joined) {
+            return; // 아직 처음부터 읽기 시작하지 않은 follower가 있다
+        }
+        for (flight_reader_t *r = f->readers; r != NULL; r = r->next) {
+            if (r->seq < min) {
+                min = r->seq;
+                slow = r->cut ? NULL : r;
+            }
+        }
+        if (f->readers == NULL) {
+            while (f->head != NULL) {
+                buf_chunk_t *c = f->head;
+                f->head = c->next;
+                f->charged -= sizeof(buf_chunk_t) + c->cap;
+                mem_flight_charge(-(long)(sizeof(buf_chunk_t) + c->cap));
+                bufpool_put(c);
+            }
+            f->tail = NULL;
+            return;
+        }
+        while (f->head != f->tail && f->head_seq < min) {
+            buf_chunk_t *c = f->head;
+            f->head = c->next;
+            f->head_seq++;
+            f->charged -= sizeof(buf_chunk_t) + c->cap;
+            mem_flight_charge(-(long)(sizeof(buf_chunk_t) + c->cap));
+            bufpool_put(c);
+        }
+        for (buf_chunk_t *c = f->head; c != NULL; c = c->next) {
+            live += c->len;
+        }
+        if (live <= FLIGHT_MAX_BUFFER) {
+            return;
+        }
+        if (slow != NULL) {
+            slow->cut = 1; // 가장 뒤처진 follower를 끊는다
+            f->cutting++;
+            shutdown(slow->fd, SHUT_RDWR);
+            pthread_cond_broadcast(&f->more);
+        }
+        while (f->cutting > 0) {
+            pthread_cond_wait(&f->more, &f->lock); // 끊긴 follower가 chunk를 놓을 때까지
+        }
+    }
+}
+
+/*
+ * flight_append - Leader: add n response bytes to the chain and wake the
+ *     followers. The chain outlives MAX_OBJECT_SIZE so that late requests
+ *     for a large object can still join; past FLIGHT_MAX_BUFFER nobody
+ *     else may join and the chain is trimmed behind the slowest follower,
+ *     or dropped if there is none, so no response pins more than about
+ *     FLIGHT_MAX_BUFFER bytes.
+ */
+void flight_append(flight_t *f, const char *buf, int n) {
+    if (f->unbuffered && f->head == NULL) {
+        return; // 따라오는 요청이 없어 버퍼를 이미 버렸다
+    }
+    if (!f->unbuffered && f->length + n > FLIGHT_MAX_BUFFER) {
+        P(&table_mutex);
+        f->unbuffered = 1; // 이후로는 새 follower를 받지 않는다
+        V(&table_mutex);
+    }
+
+    while (n > 0) {
+        buf_chunk_t *c = f->tail;
+        if (c == NULL || c->len == c->cap) {
+            c = bufpool_get();
+            f->charged += sizeof(buf_chunk_t) + c->cap;
+            mem_flight_charge(sizeof(buf_chunk_t) + c->cap);
+            pthread_mutex_lock(&f->lock);
+            if (f->tail == NULL) {
+                f->head = c;
+            } else {
+                f->tail->next = c;
+            }
+            f->tail = c;
+            pthread_mutex_unlock(&f->lock);
+        }
+        int k = MIN(n, c->cap - c->len);
+        memcpy(c->data + c->len, buf, k); // len보다 뒤쪽이므로 follower가 읽지 않는 영역
+        pthread_mutex_lock(&f->lock);
+        c->len += k;
+        f->length += k;
+        pthread_cond_broadcast(&f->more);
+        pthread_mutex_unlock(&f->lock);
+        buf += k;
+        n -= k;
+    }
+    if (f->unbuffered) {
+        pthread_mutex_lock(&f->lock);
+        flight_trim(f);
+        pthread_mutex_unlock(&f->lock);
+    }
+}
+
+/*
+ * flight_finish - Leader: the response ended; state is FLIGHT_DONE,
+ *     FLIGHT_FAILED or FLIGHT_CACHED. A complete response is compressed
+ *     here, after the followers were woken and outside the table lock;
+ *     the chain itself is left alone for followers still streaming it.
+ */
+void flight_finish(flight_t *f, int state) {
+    pthread_mutex_lock(&f->lock);
+    f->state = state;
+    pthread_cond_broadcast(&f->more);
+    pthread_mutex_unlock(&f->lock);
+
+    if (state == FLIGHT_DONE && !f->unbuffered && f->head != NULL && f->length <= MAX_OBJECT_SIZE) {
+        cache_fill_t raw;
+        cache_fill_init(&raw);
+        raw.head = f->head;
+        raw.tail = f->tail;
+        raw.length = f->length;
+        codec_compress(&raw, &f->packed);
+        for (buf_chunk_t *c = f->packed.head; c != NULL; c = c->next) {
+            f->charged += sizeof(buf_chunk_t) + c->cap;
+            mem_flight_charge(sizeof(buf_chunk_t) + c->cap); // 게시될 때까지 follower를 기다린다
+        }
+    }
+}
+
+/*
+ * flight_vary_ok - Follower, before flight_follow(): whether the response
+ *     being fetched suits a request with the header block hdrs. Until a
+ *     URI's Vary list is known, every request for it uses the plain key,
+ *     so the leader's response may be a variant this follower did not ask
+ *     for. Waits for the response headers and compares the variant keys
+ *     both requests would get under its Vary list. On a mismatch the
+ *     follower no longer counts as joined and 0 is returned; the caller
+ *     still leaves with flight_release() and fetches on its own.
+ */
+int flight_vary_ok(flight_t *f, const char *hdrs) {
+    char hdr[HTTP_MAX_HEADER], mine[MAXLINE], theirs[MAXLINE];
+    http_response_t resp;
+    int n;
+
+    if (strchr(f->uri, '\n') != NULL) {
+        return 1; // 변형 키라면 두 요청의 헤더 값이 이미 같다
+    }
+    pthread_mutex_lock(&f->lock);
+    for (;;) {
+        // follower가 시작하기 전에는 앞 chunk가 잘리지 않는다
+        n = 0;
+        for (buf_chunk_t *c = f->head; c != NULL && n < (int)sizeof(hdr) - 1; c = c->next) {
+            int k = MIN(c->len, (int)sizeof(hdr) - 1 - n);
+            memcpy(hdr + n, c->data, k);
+            n += k;
+        }
+        hdr[n] = '\0';
+        if (strstr(hdr, "\r\n\r\n") != NULL || n == (int)sizeof(hdr) - 1 || f->state != FLIGHT_FILLING) {
+            break;
+        }
+        pthread_cond_wait(&f->more, &f->lock);
+    }
+    pthread_mutex_unlock(&f->lock);
+
+    if (http_parse_response(hdr, n, &resp) < 0 || resp.vary[0] == '\0') {
+        return 1; // 변형이 없거나, 실패한 응답은 flight_follow()가 처리한다
+    }
+    if (strcmp(resp.vary, "*") != 0 &&
+        http_variant_key(f->uri, resp.vary, hdrs, mine, sizeof(mine)) >= 0 &&
+        http_variant_key(f->uri, resp.vary, f->hdrs != NULL ? f->hdrs : "", theirs, sizeof(theirs)) >= 0 &&
+        strcmp(mine, theirs) == 0) {
+        return 1;
+    }
+    P(&table_mutex);
+    f->joined--; // 읽기 시작하지 않고 떠나므로 trim을 막지 않게
+    V(&table_mutex);
+    return 0;
+}
+
+/*
+ * flight_follow - Follower: stream the flight's response to fd, waiting
+ *     for the leader whenever it catches up. Bytes below a chunk's len
+ *     never change and the chunks from the follower's own on stay alive
+ *     while it is a reader, so writes happen without the lock. Returns 1 once the
+ *     whole response was sent, 0 if the fetch failed before any byte was
+ *     sent (the caller may still send an error) and -1 otherwise.
+ */
+int flight_follow(flight_t *f, int fd) {
+    flight_reader_t me = { 0, fd, 0, NULL };
+    buf_chunk_t *c = NULL;
+    int off = 0, rc;
+    long sent = 0;
+
+    pthread_mutex_lock(&f->lock);
+    c = f->head; // 이 follower가 시작하기 전에는 잘리지 않으므로 아직 응답의 첫 chunk다
+    me.seq = f->head_seq;
+    me.next = f->readers;
+    f->readers = &me;
+    f->started++;
+    pthread_mutex_unlock(&f->lock);
+
+    for (;;) {
+        pthread_mutex_lock(&f->lock);
+        for (;;) {
+            if (c == NULL && f->head != NULL) {
+                c = f->head;
+                me.seq = f->head_seq;
+            }
+            if (c != NULL && off == c->len && c->next != NULL) {
+                c = c->next; // 다 읽은 chunk 다음으로
+                off = 0;
+                me.seq++;
+            }
+            if ((c != NULL && off < c->len) || f->state != FLIGHT_FILLING || me.cut) {
+                break;
+            }
+            pthread_cond_wait(&f->more, &f->lock);
+        }
+        int avail = c != NULL && !me.cut ? c->len - off : 0;
+        int state = f->state;
+        pthread_mutex_unlock(&f->lock);
+
+        if (me.cut) {
+            rc = -1;
+            break;
+        }
+        if (avail == 0) {
+            // leader가 끝났고 더 읽을 바이트가 없다
+            rc = state != FLIGHT_FAILED ? 1 : sent == 0 ? 0 : -1;
+            break;
+        }
+        if (rio_writen(fd, c->data + off, avail) < 0) {
+            rc = -1;
+            break;
+        }
+        off += avail;
+        sent += avail;
+    }
+
+    /* Leave the readers, so the chunks this one held can be trimmed */
+    pthread_mutex_lock(&f->lock);
+    flight_reader_t **pp = &f->readers;
+    while (*pp != &me) {
+        pp = &(*pp)->next;
+    }
+    *pp = me.next;
+    if (me.cut) {
+        f->cutting--;
+    }
+    pthread_cond_broadcast(&f->more);
+    pthread_mutex_unlock(&f->lock);
+    return rc;
+}
+
+/*
+ * flight_release - Leave a flight. The last participant unlinks it and,
+ *     if the response is complete and small enough, hands the chain to
+ *     the cache without copying. Both happen under the table lock, so
+ *     nobody can join a flight whose chain the cache already owns, and a
+ *     later miss finds the object through cache_contains().
+ */
+void flight_release(flight_t *f) {
+    P(&table_mutex);
+    if (--f->refcnt > 0) {
+        V(&table_mutex);
+        return;
+    }
+    flight_t **pp = &table[f->hash % FLIGHT_BUCKETS];
+    while (*pp != f) {
+        pp = &(*pp)->hnext;
+    }
+    *pp = f->hnext;
+    mem_flight_charge(-f->charged); // 체인은 이제 캐시의 몫이거나 풀로 돌아간다
+
+    cache_fill_t fill;
+    cache_fill_init(&fill);
+    fill.head = f->head;
+    fill.tail = f->tail;
+    fill.length = f->length;
+    fill.oversized = f->unbuffered || f->length > MAX_OBJECT_SIZE;
+    fill.gen = f->gen; // 가져오는 동안 PURGE가 있었으면 저장하지 않는다
+    fill.hdrs = f->hdrs;
+    if (f->state == FLIGHT_DONE && f->packed.head != NULL) {
+        cache_fill_discard(&fill); // 압축본이 있으면 원본 대신 그것을 캐시
+        fill = f->packed;
+        fill.gen = f->gen;
+        fill.hdrs = f->hdrs;
+    }
+    if (f->state == FLIGHT_DONE) {
+        cache_insert(f->uri, f->hash, &fill); // 캐시할 수 없으면 여기서 chunk를 반납
+    } else {
+        cache_fill_discard(&fill);
+    }
+    V(&table_mutex);
+
+    pthread_mutex_destroy(&f->lock);
+    pthread_cond_destroy(&f->more);
+    mem_overhead_charge(-(long)(sizeof(flight_t) + strlen(f->uri) + 1 + (f->hdrs != NULL ? strlen(f->hdrs) + 1 : 0)));
+    Free(f->uri);
+    Free(f->hdrs);
+    Free(f);
+}
+
+/* Dump the coalescing counters with sio only */
+void flight_print_stats(void) {
+    Sio_puts("flight: leaders=");
+    Sio_putl(leaders);
+    Sio_puts(" followers=");
+    Sio_putl(followers);
+    Sio_puts("\n");
+}
@@ -0,0 +1,68 @@
+/*
+ * flight.h - single-flight coalescing of concurrent cache misses
+ *
+ * The first thread to miss on a URI becomes the leader of a flight and
+ * is the only one to contact the origin. Threads that miss on the same
+ * URI while it is in flight join as followers and stream the response
+ * from the flight's chunk chain as the leader appends to it, from the
+ * first byte, however far the leader has got. Responses too large to
+ * cache are buffered as well, so concurrent downloads of a large object
+ * still share one fetch. Past FLIGHT_MAX_BUFFER a flight takes no more
+ * followers and frees the chunks every follower has sent; one that falls
+ * FLIGHT_MAX_BUFFER behind is cut off, so the buffer stays bounded. When the
+ * last participant leaves, the chain is handed to cache_insert(), or
+ * the gzip copy of it that the leader built once the response ended.
+ */
+#ifndef __FLIGHT_H__
+#define __FLIGHT_H__
+
+#include <pthread.h>
+#include "bufpool.h"
+#include "cache.h"
+
+#define FLIGHT_BUCKETS 1024
+#ifndef FLIGHT_MAX_BUFFER
+#define FLIGHT_MAX_BUFFER (16L * 1024 * 1024) /* Joinable prefix of a response, and most it buffers */
+#endif
+
+#define FLIGHT_FILLING 0      /* Leader is still reading the origin */
+#define FLIGHT_DONE 1         /* Complete response in the chain */
+#define FLIGHT_FAILED 2       /* Origin fetch failed; the chain is incomplete */
+#define FLIGHT_CACHED 3       /* Complete response copied from a cached entry; not inserted again */
+
+struct flight_reader;
+
+typedef struct flight {
+    unsigned long hash;
+    char *uri;
+    buf_chunk_t *head;        /* Every byte received so far */
+    buf_chunk_t *tail;
+    long length;
+    long charged;             /* Memory reported to the accountant: the flight, its chunks and packed copy */
+    int state;                /* FLIGHT_FILLING, FLIGHT_DONE, FLIGHT_FAILED or FLIGHT_CACHED */
+    int unbuffered;           /* Outgrew FLIGHT_MAX_BUFFER: no new followers, consumed chunks are freed */
+    int gzip;                 /* The origin was asked for gzip; only gzip clients may join */
+    int refcnt;               /* Leader + followers; protected by the table lock */
+    int joined;               /* Followers that ever joined; protected by the table lock */
+    int started;              /* Followers that began streaming; protected by lock */
+    struct flight_reader *readers; /* Followers streaming now; protected by lock */
+    int cutting;              /* Readers cut off for lagging that have not left yet */
+    long head_seq;            /* Chunks freed off the head of the chain */
+    long gen;                 /* cache_purge_gen() when the fetch began */
+    char *hdrs;               /* The leader's request headers, to key a varying response; or NULL */
+    cache_fill_t packed;      /* Compressed copy to cache instead of the chain, if any */
+    pthread_mutex_t lock;     /* Protects the chain tail, length and state */
+    pthread_cond_t more;      /* Broadcast when bytes arrive or the state changes */
+    struct flight *hnext;
+} flight_t;
+
+void flight_init(void);
+flight_t *flight_begin(const char *uri, unsigned long hash, int gzip, const char *hdrs, int *leader);
+void flight_append(flight_t *f, const char *buf, int n);
+void flight_finish(flight_t *f, int state);
+int flight_vary_ok(flight_t *f, const char *hdrs);
+int flight_follow(flight_t *f, int fd);
+void flight_release(flight_t *f);
+void flight_print_stats(void);
+
+#endif /* __FLIGHT_H__ */
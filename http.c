@@ -0,0 +1,530 @@
+#include "csapp.h"
+#include "http.h"
+
+static const char *months[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
+};
+
+/*
+ * http_parse_date - Parse an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT"),
+ *     the only format senders may generate. Returns 0 if s is not one.
+ */
+time_t http_parse_date(const char *s) {
+    struct tm tm;
+    char mon[4];
+
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(s, "%*3s, %d %3s %d %d:%d:%d GMT", &tm.tm_mday, mon, &tm.tm_year,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+        return 0;
+    }
+    tm.tm_mon = -1;
+    for (int i = 0; i < 12; i++) {
+        if (strcmp(mon, months[i]) == 0) {
+            tm.tm_mon = i;
+        }
+    }
+    if (tm.tm_mon < 0) {
+        return 0;
+    }
+    tm.tm_year -= 1900;
+    return timegm(&tm);
+}
+
+/* Format t as an IMF-fixdate into buf, which holds HTTP_DATE_SIZE bytes */
+void http_format_date(time_t t, char *buf) {
+    struct tm tm;
+
+    gmtime_r(&t, &tm);
+    strftime(buf, HTTP_DATE_SIZE, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+/* Read a delta-seconds directive argument such as "=3600" */
+static long delta_seconds(const char *p) {
+    while (*p == ' ') {
+        p++;
+    }
+    if (*p++ != '=') {
+        return -1;
+    }
+    if (*p == '"') {
+        p++; // 따옴표로 감싼 값도 허용
+    }
+    return isdigit((unsigned char)*p) ? atol(p) : -1;
+}
+
+/* Apply the directives of one Cache-Control header value */
+static void parse_cache_control(const char *v, http_response_t *resp) {
+    while (*v != '\0' && *v != '\r' && *v != '\n') {
+        while (*v == ' ' || *v == ',') {
+            v++;
+        }
+        if (strncasecmp(v, "max-age", 7) == 0) {
+            resp->max_age = delta_seconds(v + 7);
+        } else if (strncasecmp(v, "s-maxage", 8) == 0) {
+            resp->s_maxage = delta_seconds(v + 8);
+        } else if (strncasecmp(v, "stale-while-revalidate", 22) == 0) {
+            resp->swr = delta_seconds(v + 22);
+        } else if (strncasecmp(v, "no-store", 8) == 0) {
+            resp->no_store = 1;
+        } else if (strncasecmp(v, "no-cache", 8) == 0) {
+            resp->no_cache = 1;
+        } else if (strncasecmp(v, "private", 7) == 0) {
+            resp->private = 1;
+        }
+        while (*v != '\0' && *v != ',' && *v != '\r' && *v != '\n') {
+            v++; // 다음 지시어로
+        }
+    }
+}
+
+/*
+ * parse_vary - Append the header names of a Vary value to resp->vary.
+ *     Accept-Encoding is left out: the codec serves both codings from
+ *     one object. A list that does not fit is as good as "*".
+ */
+static void parse_vary(const char *v, http_response_t *resp) {
+    int len = strlen(resp->vary);
+
+    while (*v != '\0' && strcmp(resp->vary, "*") != 0) {
+        v += strspn(v, " \t,");
+        int k = strcspn(v, " \t,\r");
+        if (k == 0) {
+            break;
+        }
+        if (k == 1 && *v == '*') {
+            strcpy(resp->vary, "*");
+        } else if (!(k == 15 && strncasecmp(v, "Accept-Encoding", 15) == 0)) {
+            if (len + (len > 0) + k >= HTTP_MAX_VARY) {
+                strcpy(resp->vary, "*");
+                break;
+            }
+            if (len > 0) {
+                resp->vary[len++] = ',';
+            }
+            for (int i = 0; i < k; i++) {
+                resp->vary[len++] = tolower((unsigned char)v[i]);
+            }
+            resp->vary[len] = '\0';
+        }
+        v += k;
+    }
+}
+
+/*
+ * http_parse_response - Parse the status line and the caching headers of
+ *     the response at the start of buf. Returns -1 if the status line is
+ *     malformed; headers that do not fit in len are ignored.
+ */
+int http_parse_response(const char *buf, int len, http_response_t *resp) {
+    const char *p = buf, *end = buf + len;
+
+    memset(resp, 0, sizeof(*resp));
+    resp->max_age = resp->s_maxage = resp->swr = -1;
+    if (len < 12 || strncmp(buf, "HTTP/", 5) != 0 || sscanf(buf + 8, " %3d", &resp->status) != 1) {
+        resp->status = 0;
+        return -1;
+    }
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        if (eol == NULL) {
+            break; // 헤더가 잘렸다
+        }
+        if (p != buf) {
+            if (eol - p <= 1) {
+                resp->header_len = eol + 1 - buf; // 빈 줄: 헤더 끝
+                break;
+            }
+            char line[MAXLINE];
+            int n = eol - p < MAXLINE ? eol - p : MAXLINE - 1;
+            memcpy(line, p, n);
+            line[n] = '\0';
+            if (strncasecmp(line, "Cache-Control:", 14) == 0) {
+                parse_cache_control(line + 14, resp);
+            } else if (strncasecmp(line, "Expires:", 8) == 0) {
+                resp->expires = http_parse_date(line + 8 + strspn(line + 8, " "));
+                if (resp->expires == 0) {
+                    resp->expires = 1; // 잘못된 날짜는 이미 만료된 것으로 본다
+                }
+            } else if (strncasecmp(line, "Date:", 5) == 0) {
+                resp->date = http_parse_date(line + 5 + strspn(line + 5, " "));
+            } else if (strncasecmp(line, "Last-Modified:", 14) == 0) {
+                resp->last_modified = http_parse_date(line + 14 + strspn(line + 14, " "));
+            } else if (strncasecmp(line, "Age:", 4) == 0) {
+                resp->age = atol(line + 4);
+            } else if (strncasecmp(line, "ETag:", 5) == 0) {
+                char *v = line + 5 + strspn(line + 5, " ");
+                int k = strcspn(v, "\r");
+                if (k > 0 && k < HTTP_MAX_ETAG) {
+                    memcpy(resp->etag, v, k);
+                    resp->etag[k] = '\0';
+                }
+            } else if (strncasecmp(line, "Content-Encoding:", 17) == 0) {
+                char *v = line + 17 + strspn(line + 17, " ");
+                int k = strcspn(v, " \r");
+                if ((k == 4 && strncasecmp(v, "gzip", 4) == 0) || (k == 6 && strncasecmp(v, "x-gzip", 6) == 0)) {
+                    resp->encoding = HTTP_ENCODING_GZIP;
+                } else if (k > 0 && !(k == 8 && strncasecmp(v, "identity", 8) == 0)) {
+                    resp->encoding = HTTP_ENCODING_OTHER; // 여러 단계 인코딩도 포함
+                }
+            } else if (strncasecmp(line, "Surrogate-Key:", 14) == 0) {
+                resp->surrogate_key = 1;
+            } else if (strncasecmp(line, "Vary:", 5) == 0) {
+                parse_vary(line + 5, resp);
+            } else if (strncasecmp(line, "Content-Type:", 13) == 0) {
+                char *v = line + 13 + strspn(line + 13, " ");
+                int k = strcspn(v, "\r");
+                k = k < HTTP_MAX_TYPE ? k : HTTP_MAX_TYPE - 1;
+                memcpy(resp->content_type, v, k);
+                resp->content_type[k] = '\0';
+            }
+        }
+        p = eol + 1;
+    }
+    return 0;
+}
+
+/*
+ * http_header_value - Find header name in the header block hdrs and copy
+ *     its value, without surrounding blanks or the line end, into value.
+ *     Returns 1 if it was found.
+ */
+int http_header_value(const char *hdrs, const char *name, char *value, int size) {
+    int nlen = strlen(name);
+    const char *line = hdrs;
+
+    while (line != NULL && *line != '\0') {
+        if (strncasecmp(line, name, nlen) == 0 && line[nlen] == ':') {
+            const char *v = line + nlen + 1;
+            v += strspn(v, " \t");
+            int k = strcspn(v, "\r\n");
+            while (k > 0 && (v[k - 1] == ' ' || v[k - 1] == '\t')) {
+                k--;
+            }
+            k = k < size ? k : size - 1;
+            memcpy(value, v, k);
+            value[k] = '\0';
+            return 1;
+        }
+        if ((line = strchr(line, '\n')) != NULL) {
+            line++;
+        }
+    }
+    value[0] = '\0';
+    return 0;
+}
+
+/* Whether the space- or comma-separated list contains tok, ignoring case */
+int http_has_token(const char *list, const char *tok) {
+    int tlen = strlen(tok);
+
+    while (*list != '\0') {
+        list += strspn(list, " ,");
+        int k = strcspn(list, " ,");
+        if (k == tlen && strncasecmp(list, tok, k) == 0) {
+            return 1;
+        }
+        list += k;
+    }
+    return 0;
+}
+
+/*
+ * http_accepts_encoding - Whether an Accept-Encoding value allows the
+ *     content coding: listed by name, or covered by "*", with a non-zero
+ *     q-value. An empty value allows nothing but identity.
+ */
+int http_accepts_encoding(const char *value, const char *coding) {
+    int clen = strlen(coding), named = 0, star = 0;
+    const char *p = value;
+
+    while (*p != '\0') {
+        p += strspn(p, " ,");
+        int k = strcspn(p, " ;,");
+        int match = k == clen && strncasecmp(p, coding, k) == 0;
+        int wild = k == 1 && *p == '*';
+        p += k;
+        p += strspn(p, " ");
+
+        // q=0은 명시적인 거부이고, 생략되면 1로 본다
+        double q = 1;
+        if (*p == ';') {
+            const char *qp = strstr(p, "q=");
+            const char *end = p + strcspn(p, ",");
+            if (qp != NULL && qp < end) {
+                q = atof(qp + 2);
+            }
+            p = end;
+        }
+        if (match) {
+            named = q > 0 ? 1 : -1;
+        } else if (wild) {
+            star = q > 0 ? 1 : -1;
+        }
+    }
+    return named != 0 ? named > 0 : star > 0;
+}
+
+/*
+ * http_parse_range - Resolve a Range header value ("bytes=0-99,-500")
+ *     against an object of total bytes. Fills ranges with the satisfiable
+ *     ones and returns their count: 0 means none is satisfiable (416),
+ *     -1 that the header is malformed or asks for more than
+ *     HTTP_MAX_RANGES ranges and must be ignored.
+ */
+int http_parse_range(const char *value, long total, http_range_t *ranges) {
+    const char *p = value + strspn(value, " ");
+    int n = 0, seen = 0;
+
+    if (strncasecmp(p, "bytes=", 6) != 0) {
+        return -1;
+    }
+    p += 6;
+    for (;;) {
+        long first = -1, last = -1;
+        char *end;
+
+        p += strspn(p, " ");
+        if (isdigit((unsigned char)*p)) {
+            first = strtol(p, &end, 10);
+            p = end;
+        }
+        if (*p++ != '-') {
+            return -1;
+        }
+        if (isdigit((unsigned char)*p)) {
+            last = strtol(p, &end, 10);
+            p = end;
+        }
+        if ((first < 0 && last < 0) || (first >= 0 && last >= 0 && last < first) || ++seen > HTTP_MAX_RANGES) {
+            return -1;
+        }
+
+        if (first < 0) {
+            // 접미 범위: 마지막 last 바이트
+            if (last > 0 && total > 0) {
+                ranges[n].first = last < total ? total - last : 0;
+                ranges[n].last = total - 1;
+                n++;
+            }
+        } else if (first < total) {
+            ranges[n].first = first;
+            ranges[n].last = last < 0 || last >= total ? total - 1 : last;
+            n++;
+        }
+
+        p += strspn(p, " ");
+        if (*p == '\0' || *p == '\r' || *p == '\n') {
+            return n;
+        }
+        if (*p++ != ',') {
+            return -1;
+        }
+    }
+}
+
+/* Unreserved characters (RFC 3986) mean the same percent-encoded or not */
+static int unreserved(int c) {
+    return isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+/*
+ * copy_encoded - Append [p, end) to out with percent-encoding normalised:
+ *     escaped unreserved characters are decoded and the hex digits of the
+ *     remaining escapes are upper-cased. Returns the new length.
+ */
+static int copy_encoded(char *out, int len, int size, const char *p, const char *end) {
+    static const char hex[] = "0123456789ABCDEF";
+
+    while (p < end && len < size - 1) {
+        if (*p == '%' && end - p >= 3 && isxdigit((unsigned char)p[1]) && isxdigit((unsigned char)p[2])) {
+            int c = (isdigit((unsigned char)p[1]) ? p[1] - '0' : (toupper(p[1]) - 'A' + 10)) * 16 +
+                    (isdigit((unsigned char)p[2]) ? p[2] - '0' : (toupper(p[2]) - 'A' + 10));
+            if (unreserved(c)) {
+                out[len++] = c;
+            } else if (len < size - 3) {
+                out[len++] = '%';
+                out[len++] = hex[c >> 4];
+                out[len++] = hex[c & 15];
+            } else {
+                break;
+            }
+            p += 3;
+        } else {
+            out[len++] = *p++;
+        }
+    }
+    return p < end ? -1 : len;
+}
+
+/* One query parameter while the query is being sorted */
+typedef struct {
+    const char *p;
+    int len;
+    int keylen;               // 정렬 기준 길이 (이름만 또는 name=value 전체)
+    int pos;                  // 원래 순서 (같은 키끼리의 순서를 지키기 위해)
+} query_param_t;
+
+static int param_cmp(const void *a, const void *b) {
+    const query_param_t *x = a, *y = b;
+    int c = memcmp(x->p, y->p, x->keylen < y->keylen ? x->keylen : y->keylen);
+
+    if (c == 0) {
+        c = x->keylen - y->keylen;
+    }
+    return c != 0 ? c : x->pos - y->pos;
+}
+
+/*
+ * copy_query - Append the query [p, end) to out, its parameters sorted
+ *     by query_order. Returns the new length, or -1 if it does not fit.
+ */
+static int copy_query(char *out, int len, int size, const char *p, const char *end, int query_order) {
+    query_param_t params[HTTP_MAX_QUERY_PARAMS];
+    int n = 0;
+
+    if (query_order == HTTP_QUERY_KEEP) {
+        return copy_encoded(out, len, size, p, end);
+    }
+    for (;;) {
+        if (n == HTTP_MAX_QUERY_PARAMS) {
+            return copy_encoded(out, len, size, params[0].p, end); // 너무 길면 정렬하지 않는다
+        }
+        const char *amp = memchr(p, '&', end - p);
+        const char *e = amp != NULL ? amp : end;
+        const char *eq = memchr(p, '=', e - p);
+        params[n].p = p;
+        params[n].len = e - p;
+        params[n].keylen = query_order == HTTP_QUERY_SORT_NAME && eq != NULL ? eq - p : e - p;
+        params[n].pos = n;
+        n++;
+        if (amp == NULL) {
+            break;
+        }
+        p = amp + 1;
+    }
+    qsort(params, n, sizeof(params[0]), param_cmp);
+    for (int i = 0; i < n; i++) {
+        if (i > 0) {
+            if (len >= size - 1) {
+                return -1;
+            }
+            out[len++] = '&';
+        }
+        if ((len = copy_encoded(out, len, size, params[i].p, params[i].p + params[i].len)) < 0) {
+            return -1;
+        }
+    }
+    return len;
+}
+/*
+ * http_normalize_uri - Canonicalise an absolute http:// URI into out so
+ *     that equivalent spellings share a cache key: the scheme and host
+ *     are lower-cased, the default port, the fragment and an empty query
+ *     are dropped, an empty path becomes "/", percent-encoding is
+ *     normalised and query parameters are ordered by query_order.
+ *     Returns the length, or -1 if uri is not absolute http:// or the
+ *     result does not fit in size bytes.
+ */
+int http_normalize_uri(const char *uri, char *out, int size, int query_order) {
+    const char *host, *hend, *port, *path, *pend, *query, *qend;
+    int len = 0;
+
+    if (strncasecmp(uri, "http://", 7) != 0 || size < 8) {
+        return -1;
+    }
+    host = uri + 7;
+    hend = host + strcspn(host, "/?#");
+    port = NULL;
+    for (const char *p = hend; p > host && p[-1] != ']'; p--) {
+        if (p[-1] == ':') {
+            port = p; // IPv6 주소의 ':'는 ']' 앞에 있으므로 건너뛴다
+            break;
+        }
+    }
+    path = hend;
+    pend = path + strcspn(path, "?#");
+    query = *pend == '?' ? pend + 1 : NULL;
+    qend = query != NULL ? query + strcspn(query, "#") : NULL;
+
+    memcpy(out, "http://", 7);
+    len = 7;
+    for (const char *p = host; p < (port != NULL ? port - 1 : hend); p++) {
+        if (len >= size - 1) {
+            return -1;
+        }
+        out[len++] = tolower((unsigned char)*p);
+    }
+    if (port != NULL && !(hend - port == 0 || (hend - port == 2 && strncmp(port, "80", 2) == 0))) {
+        if (len + 1 + (hend - port) >= size) {
+            return -1;
+        }
+        out[len++] = ':';
+        memcpy(out + len, port, hend - port);
+        len += hend - port;
+    }
+
+    if (pend == path) {
+        if (len >= size - 1) {
+            return -1;
+        }
+        out[len++] = '/';
+    } else if ((len = copy_encoded(out, len, size, path, pend)) < 0) {
+        return -1;
+    }
+
+    if (query != NULL && qend > query) {
+        if (len >= size - 1) {
+            return -1;
+        }
+        out[len++] = '?';
+        if ((len = copy_query(out, len, size, query, qend, query_order)) < 0) {
+            return -1;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/*
+ * http_variant_key - Build in key the cache key of the variant of uri
+ *     that a request with the header block hdrs gets, when responses for
+ *     uri vary by the comma-separated header names in vary: uri, then a
+ *     "\nname:value" line per name. Values are lower-cased with their
+ *     blanks collapsed, so spellings that mean the same share a variant;
+ *     a missing header has an empty value. Returns the length, or -1 if
+ *     the key does not fit in size bytes.
+ */
+int http_variant_key(const char *uri, const char *vary, const char *hdrs, char *key, int size) {
+    char name[HTTP_MAX_VARY], value[MAXLINE];
+    int len = snprintf(key, size, "%s", uri);
+
+    if (len >= size) {
+        return -1;
+    }
+    while (*vary != '\0') {
+        int k = strcspn(vary, ",");
+        memcpy(name, vary, k);
+        name[k] = '\0';
+        vary += k + (vary[k] == ',');
+        http_header_value(hdrs, name, value, sizeof(value));
+        if (len + k + 3 >= size) {
+            return -1;
+        }
+        len += sprintf(key + len, "\n%s:", name);
+        for (const char *v = value; *v != '\0'; v++) {
+            if (*v == ' ' || *v == '\t') {
+                if (v[1] == ' ' || v[1] == '\t' || v[1] == ',' || (v > value && v[-1] == ',')) {
+                    continue; // 쉼표 주변과 연속된 공백은 뜻이 없다
+                }
+            }
+            if (len >= size - 1) {
+                return -1;
+            }
+            key[len++] = *v == '\t' ? ' ' : tolower((unsigned char)*v);
+        }
+        key[len] = '\0';
+    }
+    return len;
+}
@@ -0,0 +1,67 @@
+/*
+ * http.h - parsing of the HTTP response headers stored with cached objects
+ *
+ * The cache keeps whole responses, status line and headers included, so
+ * everything the cache needs to know about an object is read back from
+ * its first bytes once, when the fill completes.
+ */
+#ifndef __HTTP_H__
+#define __HTTP_H__
+
+#include <time.h>
+
+#define HTTP_MAX_HEADER (2 * 8192) /* Longest response header block that is parsed */
+#define HTTP_MAX_ETAG 256             /* Longer entity tags are ignored */
+#define HTTP_DATE_SIZE 32             /* Buffer size for http_format_date() */
+#define HTTP_MAX_QUERY_PARAMS 64      /* Longer queries are left in their original order */
+#define HTTP_MAX_RANGES 16            /* Range requests with more ranges get the whole object */
+#define HTTP_MAX_TYPE 128             /* Longer Content-Type values are truncated */
+#define HTTP_MAX_VARY 128             /* Longer Vary lists make a response uncacheable */
+
+/* Content-Encoding of a response body */
+#define HTTP_ENCODING_IDENTITY 0      /* None */
+#define HTTP_ENCODING_GZIP 1          /* gzip or x-gzip */
+#define HTTP_ENCODING_OTHER 2         /* Anything else; never decoded */
+
+/* How http_normalize_uri() orders query parameters */
+#define HTTP_QUERY_KEEP 0             /* As sent */
+#define HTTP_QUERY_SORT_NAME 1        /* By name; repeated names keep their relative order */
+#define HTTP_QUERY_SORT_FULL 2        /* By the whole name=value pair */
+
+typedef struct {
+    int status;               /* Status code, 0 if the status line is malformed */
+    int header_len;           /* Bytes up to and including the blank line, 0 if not found */
+    long max_age;             /* Cache-Control: max-age, -1 if absent */
+    long s_maxage;            /* Cache-Control: s-maxage, -1 if absent */
+    long swr;                 /* Cache-Control: stale-while-revalidate, -1 if absent */
+    int no_store;
+    int no_cache;
+    int private;
+    time_t date;              /* Date, 0 if absent or invalid */
+    time_t expires;           /* Expires; 0 if absent, 1 if invalid (already expired) */
+    time_t last_modified;     /* Last-Modified, 0 if absent or invalid */
+    long age;                 /* Age, 0 if absent */
+    char etag[HTTP_MAX_ETAG]; /* ETag, quotes included; empty if absent */
+    int encoding;             /* HTTP_ENCODING_IDENTITY, _GZIP or _OTHER */
+    char content_type[HTTP_MAX_TYPE]; /* Content-Type value; empty if absent */
+    int surrogate_key;        /* Has a Surrogate-Key header (purge tags) */
+    char vary[HTTP_MAX_VARY]; /* Vary names, lower-cased and comma-joined; "*" if any variant is possible */
+} http_response_t;
+
+/* One satisfiable byte range, resolved against the object length */
+typedef struct {
+    long first;
+    long last;                /* Inclusive */
+} http_range_t;
+
+int http_parse_response(const char *buf, int len, http_response_t *resp);
+int http_parse_range(const char *value, long total, http_range_t *ranges);
+int http_header_value(const char *hdrs, const char *name, char *value, int size);
+int http_accepts_encoding(const char *value, const char *coding);
+int http_has_token(const char *list, const char *tok);
+time_t http_parse_date(const char *s);
+void http_format_date(time_t t, char *buf);
+int http_normalize_uri(const char *uri, char *out, int size, int query_order);
+int http_variant_key(const char *uri, const char *vary, const char *hdrs, char *key, int size);
+
+#endif /* __HTTP_H__ */
@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# loadtest-hitratio.sh - Replay a skewed trace over tiny/cache_test through
+#     the proxy and print the proxy's cache counters afterwards.
+#
+#     Each round fetches the hot pages (home.html, godzilla.jpg) and then
+#     three one-off objects from the cache_test corpus, so a policy that
+#     protects recently hit objects keeps the hot pages resident while the
+#     cold stream churns through the rest of the cache.
+#
+#     usage: ./loadtest-hitratio.sh <proxy_pid> <proxy_port> <tiny_port> [rounds]
+#
+
+PROXY_PID=$1
+PROXY_PORT=$2
+TINY_PORT=$3
+ROUNDS=${4:-30}
+
+HOT="home.html godzilla.jpg"
+COLD="cache_test/test1.txt cache_test/test2.txt cache_test/test3.txt
+cache_test/test4.txt cache_test/test5.txt cache_test/test6.txt
+cache_test/test7.txt cache_test/test8.txt cache_test/test9.txt
+cache_test/test10.txt cache_test/test11.txt cache_test/test12.txt
+cache_test/test13.txt cache_test/test14.txt cache_test/test15.txt
+csapp.c tiny.c"
+NCOLD=$(echo $COLD | wc -w)
+
+fetch() {
+    curl --max-time 5 --silent --proxy "http://localhost:${PROXY_PORT}" \
+        --output /dev/null "http://localhost:${TINY_PORT}/$1"
+}
+
+cold=0
+i=1
+while [ "$i" -le "$ROUNDS" ]; do
+    for file in $HOT; do
+        fetch "$file"
+    done
+    for k in 1 2 3; do
+        file=$(echo $COLD | cut -d' ' -f$((cold % NCOLD + 1)))
+        fetch "$file"
+        cold=$((cold + 1))
+    done
+    i=$((i + 1))
+done
+
+echo "Replayed $ROUNDS rounds ($((ROUNDS * 5)) requests)"
+kill -USR1 "$PROXY_PID"
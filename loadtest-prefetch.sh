@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# loadtest-prefetch.sh - Fetch a generated HTML page through a proxy
+#     started with -P and check that it comes back intact.
+#
+#     The page sits a few long directories deep and links one ordinary
+#     image and, in an <img src>, a relative path of nearly MAXLINE bytes,
+#     so the resolved path is longer than any cache key. The prefetcher must skip that
+#     link, fetch the image, and keep serving afterwards.
+#
+#     usage: ./loadtest-prefetch.sh <proxy_pid> <proxy_port> <tiny_port>
+#
+
+PROXY_PID=$1
+PROXY_PORT=$2
+TINY_PORT=$3
+seg=$(head -c 200 /dev/zero | tr '\0' 'd')
+SUB=prefetch_test/$seg/$seg/$seg/$seg
+PAGE=tiny/$SUB/longlink.html
+
+mkdir -p "tiny/$SUB"
+long=$(head -c 8000 /dev/zero | tr '\0' 'a' | sed 's/a\{63\}/&\//g')
+printf '<html><body>\n<img src="/godzilla.gif">\n<img src="%s">\n</body></html>\n' "$long" > "$PAGE"
+
+fetch() {
+    curl --max-time 5 --silent --proxy "http://localhost:${PROXY_PORT}" \
+        "http://localhost:${TINY_PORT}/$1"
+}
+
+status=0
+if fetch "$SUB/longlink.html" | cmp -s - "$PAGE"; then
+    echo "Page with an oversized link served intact"
+else
+    echo "Page with an oversized link was not served intact"
+    status=1
+fi
+sleep 1
+if fetch home.html | cmp -s - tiny/home.html; then
+    echo "Proxy still serving"
+else
+    echo "Proxy stopped serving"
+    status=1
+fi
+
+rm -rf tiny/prefetch_test
+kill -USR1 "$PROXY_PID"
+exit $status
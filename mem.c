@@ -0,0 +1,181 @@
+#include "csapp.h"
+#include "cache.h"
+#include "slab.h"
+#include "mem.h"
+
+static long configured;         /* -M: the budget is never larger */
+static long target;             /* Budget after pressure adjustments */
+static long applied;            /* Last size given to cache_resize() */
+static long flight_bytes;       /* Buffers of responses still being fetched */
+static long overhead_bytes;     /* Heap the cache holds outside slab pages */
+static long held;               /* Slab pages plus overhead at the last check */
+static long cgroup_limit, cgroup_usage; /* 0 when there is no limit */
+static char cgroup_dir[MAXLINE];        /* This process's cgroup v2 path, "" at the root */
+static double psi_some;         /* Last "some avg10" reading, -1 without PSI */
+static long shrinks, grows;
+
+/* Read the first number in path after prefix; returns -1 if there is none */
+static double read_number(const char *path, const char *prefix) {
+    char buf[MAXLINE];
+    double v = -1;
+    FILE *fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        return -1;
+    }
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        char *p = strstr(buf, prefix);
+        if (p != NULL && sscanf(p + strlen(prefix), "%lf", &v) == 1) {
+            break;
+        }
+    }
+    fclose(fp);
+    return v;
+}
+
+/*
+ * read_cgroup - Find this process's memory limit and usage: cgroup v2
+ *     memory.max/memory.current under the path in /proc/self/cgroup, or
+ *     the v1 memory controller. An unlimited cgroup leaves the limit 0.
+ */
+static void read_cgroup(void) {
+    char line[MAXLINE], path[2 * MAXLINE];
+    FILE *fp = fopen("/proc/self/cgroup", "r");
+    double limit = -1, usage = -1;
+
+    cgroup_dir[0] = '\0';
+    if (fp != NULL) {
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            if (strncmp(line, "0::", 3) == 0) {
+                line[strcspn(line, "\n")] = '\0';
+                snprintf(cgroup_dir, sizeof(cgroup_dir), "%s", strcmp(line + 3, "/") == 0 ? "" : line + 3);
+            }
+        }
+        fclose(fp);
+    }
+    snprintf(path, sizeof(path), "/sys/fs/cgroup%s/memory.max", cgroup_dir);
+    if ((limit = read_number(path, "")) >= 0) { // "max"이면 숫자가 없어 -1
+        snprintf(path, sizeof(path), "/sys/fs/cgroup%s/memory.current", cgroup_dir);
+        usage = read_number(path, "");
+    } else if ((limit = read_number("/sys/fs/cgroup/memory/memory.limit_in_bytes", "")) >= 0) {
+        usage = read_number("/sys/fs/cgroup/memory/memory.usage_in_bytes", "");
+    }
+    // v1은 제한이 없을 때 거의 LONG_MAX를 보고한다
+    cgroup_limit = limit > 0 && limit < (double)(1L << 60) ? (long)limit : 0;
+    cgroup_usage = usage > 0 ? (long)usage : 0;
+}
+
+/* "some avg10" of this cgroup's own memory.pressure, or of the whole system without one */
+static double read_psi(void) {
+    char path[2 * MAXLINE];
+    double v;
+
+    snprintf(path, sizeof(path), "/sys/fs/cgroup%s/memory.pressure", cgroup_dir);
+    if ((v = read_number(path, "some avg10=")) >= 0) {
+        return v;
+    }
+    return read_number("/proc/pressure/memory", "some avg10=");
+}
+
+/*
+ * mem_adjust - One step of the monitor: move the target against the
+ *     pressure readings and keep it within the configured budget and the
+ *     cgroup share. Then compare it with what the cache really holds,
+ *     its slab pages and the heap overhead, which also covers flight
+ *     buffers, ghosts, shared bodies and the space lost to partly used
+ *     pages. The cache budget shrinks by what is held over the target
+ *     and grows into what is left under it, at most MEM_SHRINK_PERCENT
+ *     and MEM_GROW_PERCENT a second.
+ */
+static void mem_adjust(void) {
+    long ceiling = configured, size;
+    int pressure;
+
+    read_cgroup();
+    psi_some = read_psi();
+    if (cgroup_limit > 0) {
+        ceiling = MIN(ceiling, cgroup_limit / 100 * MEM_CGROUP_SHARE);
+    }
+    pressure = psi_some >= MEM_PSI_HIGH ||
+               (cgroup_limit > 0 && cgroup_usage / MEM_CGROUP_HIGH > cgroup_limit / 100);
+    if (pressure) {
+        target -= target / 100 * MEM_SHRINK_PERCENT;
+        shrinks++;
+    } else if (psi_some < MEM_PSI_LOW && target < ceiling) {
+        target += configured / 100 * MEM_GROW_PERCENT;
+        grows++;
+    }
+    target = MAX(MIN(target, ceiling), MIN(MEM_MIN_BUDGET, ceiling));
+
+    held = slab_pages() * SLAB_PAGE_SIZE + __atomic_load_n(&overhead_bytes, __ATOMIC_RELAXED);
+    if (held > target) {
+        slab_trim(); // 풀에 쌓인 빈 페이지부터 돌려준다
+        held = slab_pages() * SLAB_PAGE_SIZE + __atomic_load_n(&overhead_bytes, __ATOMIC_RELAXED);
+    }
+    if (held > target) {
+        size = applied - MIN(held - target, applied / 100 * MEM_SHRINK_PERCENT);
+    } else {
+        size = applied + MIN(target - held, configured / 100 * MEM_GROW_PERCENT);
+    }
+    size = MAX(MIN(size, target), MIN(MEM_MIN_BUDGET, target));
+    if (size != applied) {
+        applied = size;
+        cache_resize(size);
+    }
+}
+
+/* Monitor thread: re-size the cache budget once a second */
+static void *mem_monitor(void *vargp) {
+    Pthread_detach(pthread_self());
+    for (;;) {
+        sleep(1);
+        mem_adjust();
+    }
+    return NULL;
+}
+
+/* Start accounting against budget bytes; the cache must already be initialised with it */
+void mem_init(long budget) {
+    pthread_t tid;
+
+    configured = target = applied = budget;
+    psi_some = -1;
+    Pthread_create(&tid, NULL, mem_monitor, NULL);
+}
+
+/* Flight buffers grew (bytes > 0) or were released or handed to the cache (bytes < 0) */
+void mem_flight_charge(long bytes) {
+    __atomic_fetch_add(&flight_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+/* Heap memory outside the slab pages grew (bytes > 0) or was freed (bytes < 0) */
+void mem_overhead_charge(long bytes) {
+    __atomic_fetch_add(&overhead_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+/* Dump the accountant's view with sio only */
+void mem_print_stats(void) {
+    Sio_puts("mem: configured=");
+    Sio_putl(configured);
+    Sio_puts(" budget=");
+    Sio_putl(target);
+    Sio_puts(" cache=");
+    Sio_putl(applied);
+    Sio_puts(" flight=");
+    Sio_putl(flight_bytes);
+    Sio_puts(" overhead=");
+    Sio_putl(overhead_bytes);
+    Sio_puts(" held=");
+    Sio_putl(held);
+    Sio_puts(" psi=");
+    Sio_putl((long)psi_some);
+    Sio_puts("% cgroup_limit=");
+    Sio_putl(cgroup_limit);
+    Sio_puts(" cgroup_usage=");
+    Sio_putl(cgroup_usage);
+    Sio_puts(" shrinks=");
+    Sio_putl(shrinks);
+    Sio_puts(" grows=");
+    Sio_putl(grows);
+    Sio_puts("\n");
+}
@@ -0,0 +1,34 @@
+/*
+ * mem.h - memory accountant and pressure-adaptive cache budget
+ *
+ * The shards charge entry items, body chunks, the hash index and the
+ * sketch against their own budget, but that per-item sum misses flight
+ * buffers, ghosts, shared bodies and the free space in partly used slab
+ * pages. The accountant therefore measures what the cache really holds:
+ * every slab page taken from the system plus the heap overhead (indexes,
+ * sketches, the ghost, dedup, Vary and disk tables, flight structs).
+ *
+ * Once a second a monitor thread sets a target. It never goes above the
+ * configured budget or a share of the cgroup memory limit. It shrinks
+ * while PSI reports memory stalls (for the cgroup when it has its own
+ * memory.pressure, else for the system) or the cgroup nears its limit,
+ * and grows back slowly once the pressure is gone. The shards' budget
+ * then follows the gap between the target and what is held.
+ */
+#ifndef __MEM_H__
+#define __MEM_H__
+
+#define MEM_MIN_BUDGET (16L * 1024 * 1024) /* The budget never shrinks below this */
+#define MEM_PSI_HIGH 10.0         /* "some avg10" stall percent that shrinks the budget */
+#define MEM_PSI_LOW 1.0           /* Below this the budget grows back */
+#define MEM_SHRINK_PERCENT 10     /* Of the current budget, per second under pressure */
+#define MEM_GROW_PERCENT 2        /* Of the configured budget, per quiet second */
+#define MEM_CGROUP_SHARE 75       /* Percent of the cgroup limit the cache may use */
+#define MEM_CGROUP_HIGH 90        /* cgroup usage percent that counts as pressure */
+
+void mem_init(long budget);
+void mem_flight_charge(long bytes);
+void mem_overhead_charge(long bytes);
+void mem_print_stats(void);
+
+#endif /* __MEM_H__ */
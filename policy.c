@@ -0,0 +1,342 @@
+#include "csapp.h"
+#include "cache.h"
+#include "slab.h"
+#include "mem.h"
+
+/*
+ * policy.c - FIFO, CLOCK, LRU, ARC and S3-FIFO eviction for cache shards
+ *
+ * Every hook except on_hit is called with the shard's sem held. Sizes are
+ * counted in bytes, not entries, because objects differ in size by up to
+ * MAX_OBJECT_SIZE.
+ */
+
+/* Space the policy may fill: the shard minus its admission window */
+static long main_capacity(cache_shard_t *sh) {
+    return sh->max_size - sh->win_max;
+}
+
+/* Append e at the tail (newest end) of sh->lists[list] */
+void policy_list_append(cache_shard_t *sh, int list, cache_entry_t *e) {
+    cache_list_t *l = &sh->lists[list];
+
+    e->list = list;
+    e->next = NULL;
+    e->prev = l->tail;
+    if (l->tail == NULL) {
+        l->head = e;
+    } else {
+        l->tail->next = e;
+    }
+    l->tail = e;
+    l->bytes += e->size;
+}
+
+/* Unlink e from whichever list it is on */
+void policy_list_remove(cache_shard_t *sh, cache_entry_t *e) {
+    cache_list_t *l;
+
+    if (e->list == POLICY_LIST_NONE) {
+        return;
+    }
+    l = &sh->lists[e->list];
+    if (e->prev == NULL) {
+        l->head = e->next;
+    } else {
+        e->prev->next = e->next;
+    }
+    if (e->next == NULL) {
+        l->tail = e->prev;
+    } else {
+        e->next->prev = e->prev;
+    }
+    l->bytes -= e->size;
+    e->prev = e->next = NULL;
+    e->list = POLICY_LIST_NONE;
+}
+
+/* Move e to the tail of list, possibly a different one */
+static void list_move(cache_shard_t *sh, int list, cache_entry_t *e) {
+    policy_list_remove(sh, e);
+    policy_list_append(sh, list, e);
+}
+
+/*
+ * Ghost lists
+ */
+
+static void ghost_init(ghost_t *g, long max_bytes) {
+    int n = 64;
+
+    while ((long)n < max_bytes / CACHE_AVG_OBJECT_SIZE) {
+        n <<= 1;
+    }
+    g->head = g->tail = NULL;
+    g->buckets = Calloc(n, sizeof(ghost_node_t *));
+    mem_overhead_charge(n * sizeof(ghost_node_t *)); // 샤드 예산 밖의 힙: accountant가 센다
+    g->nbuckets = n;
+    g->bytes = 0;
+    g->max_bytes = max_bytes;
+}
+
+/* Unlink node from both the FIFO and its bucket and free it */
+static void ghost_unlink(ghost_t *g, ghost_node_t *node) {
+    ghost_node_t **pp = &g->buckets[node->hash & (g->nbuckets - 1)];
+
+    while (*pp != node) {
+        pp = &(*pp)->hnext;
+    }
+    *pp = node->hnext;
+    if (node->prev == NULL) {
+        g->head = node->next;
+    } else {
+        node->prev->next = node->next;
+    }
+    if (node->next == NULL) {
+        g->tail = node->prev;
+    } else {
+        node->next->prev = node->prev;
+    }
+    g->bytes -= node->size;
+    slab_free(node);
+}
+
+/* Remember an evicted entry, forgetting the oldest ones beyond max_bytes */
+static void ghost_add(ghost_t *g, unsigned long hash, long size) {
+    ghost_node_t *node = slab_alloc(sizeof(ghost_node_t));
+    ghost_node_t **bucket = &g->buckets[hash & (g->nbuckets - 1)];
+
+    node->hash = hash;
+    node->size = size;
+    node->hnext = *bucket;
+    *bucket = node;
+    node->next = NULL;
+    node->prev = g->tail;
+    if (g->tail == NULL) {
+        g->head = node;
+    } else {
+        g->tail->next = node;
+    }
+    g->tail = node;
+    g->bytes += size;
+    while (g->bytes > g->max_bytes && g->head != NULL) {
+        ghost_unlink(g, g->head);
+    }
+}
+
+/* If hash is remembered, forget it and return 1 */
+static int ghost_take(ghost_t *g, unsigned long hash) {
+    for (ghost_node_t *n = g->buckets[hash & (g->nbuckets - 1)]; n != NULL; n = n->hnext) {
+        if (n->hash == hash) {
+            ghost_unlink(g, n);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Forget every ghost node stored in [lo, hi), a slab page being drained; caller holds sh->sem */
+void policy_ghost_drop(cache_shard_t *sh, void *lo, void *hi) {
+    for (int i = 0; i < POLICY_NGHOSTS; i++) {
+        ghost_node_t *n = sh->ghost[i].head;
+        while (n != NULL) {
+            ghost_node_t *next = n->next;
+            if ((void *)n >= lo && (void *)n < hi) {
+                ghost_unlink(&sh->ghost[i], n);
+            }
+            n = next;
+        }
+    }
+}
+
+/*
+ * FIFO and CLOCK: one list in insertion order. CLOCK gives entries whose
+ * reference bit was set by a hit one more trip round the list.
+ */
+
+static void single_init(cache_shard_t *sh) {
+}
+
+static void single_insert(cache_shard_t *sh, cache_entry_t *e) {
+    policy_list_append(sh, 0, e);
+}
+
+static void fifo_hit(cache_shard_t *sh, cache_entry_t *e) {
+}
+
+static cache_entry_t *fifo_victim(cache_shard_t *sh) {
+    return sh->lists[0].head;
+}
+
+static void single_remove(cache_shard_t *sh, cache_entry_t *e, int evicted) {
+    policy_list_remove(sh, e);
+}
+
+static void clock_hit(cache_shard_t *sh, cache_entry_t *e) {
+    // 히트는 참조 비트만 세운다 (리스트 재배치 없음, O(1))
+    __atomic_store_n(&e->referenced, 1, __ATOMIC_RELAXED);
+}
+
+/* Advance the hand past referenced entries, clearing their bit */
+static cache_entry_t *clock_victim(cache_shard_t *sh) {
+    cache_entry_t *e;
+
+    while ((e = sh->lists[0].head) != NULL &&
+           __atomic_exchange_n(&e->referenced, 0, __ATOMIC_RELAXED)) {
+        list_move(sh, 0, e); // 최근에 히트된 항목은 tail로 보내 한 바퀴 더 유지
+    }
+    return e;
+}
+
+/*
+ * LRU: every hit moves the entry to the tail, so hits need the shard
+ * lock. The lookup path only takes it with sem_trywait(); under
+ * contention a hit is not recorded rather than making readers wait.
+ */
+
+static void lru_hit(cache_shard_t *sh, cache_entry_t *e) {
+    if (e->list == 0) {
+        list_move(sh, 0, e);
+    }
+}
+
+/*
+ * ARC: lists[0] (T1) holds entries seen once, lists[1] (T2) entries hit
+ * again. Ghosts B1 and B2 remember what each list evicted; a ghost hit
+ * on insert moves the T1 target (sh->target) toward the list that would
+ * have kept the entry, so the split adapts between recency and frequency.
+ */
+
+static void arc_init(cache_shard_t *sh) {
+    sh->target = 0;
+    ghost_init(&sh->ghost[0], main_capacity(sh));
+    ghost_init(&sh->ghost[1], main_capacity(sh));
+}
+
+static void arc_resize(cache_shard_t *sh) {
+    sh->target = MIN(sh->target, main_capacity(sh));
+    sh->ghost[0].max_bytes = sh->ghost[1].max_bytes = main_capacity(sh); // 넘친 기록은 다음 추가 때 잊는다
+}
+
+static void arc_insert(cache_shard_t *sh, cache_entry_t *e) {
+    long b1 = sh->ghost[0].bytes, b2 = sh->ghost[1].bytes;
+
+    if (ghost_take(&sh->ghost[0], e->hash)) {
+        // B1 히트: T1이 조금만 더 컸다면 남아 있었을 항목
+        sh->target = MIN(main_capacity(sh), sh->target + MAX(b2 / MAX(b1, 1), 1) * e->size);
+        policy_list_append(sh, 1, e);
+    } else if (ghost_take(&sh->ghost[1], e->hash)) {
+        // B2 히트: T2 쪽에 공간을 더 준다
+        sh->target = MAX(0, sh->target - MAX(b1 / MAX(b2, 1), 1) * e->size);
+        policy_list_append(sh, 1, e);
+    } else {
+        policy_list_append(sh, 0, e);
+    }
+}
+
+static void arc_hit(cache_shard_t *sh, cache_entry_t *e) {
+    if (e->list == 0 || e->list == 1) {
+        list_move(sh, 1, e);
+    }
+}
+
+static cache_entry_t *arc_victim(cache_shard_t *sh) {
+    cache_list_t *t1 = &sh->lists[0], *t2 = &sh->lists[1];
+
+    if (t1->head != NULL && (t1->bytes > sh->target || t2->head == NULL)) {
+        return t1->head;
+    }
+    return t2->head;
+}
+
+static void arc_remove(cache_shard_t *sh, cache_entry_t *e, int evicted) {
+    if (evicted && (e->list == 0 || e->list == 1)) {
+        ghost_add(&sh->ghost[e->list], e->hash, e->size);
+    }
+    policy_list_remove(sh, e);
+}
+
+/*
+ * S3-FIFO: new entries go to a small FIFO (lists[0]) sized at
+ * POLICY_S3_SMALL_PERCENT of the space. Entries hit while there move on
+ * to the main FIFO (lists[1]); the rest are evicted and remembered in a
+ * ghost, and come back straight into main if requested again. Main is a
+ * CLOCK with a small counter instead of a bit. Hits only bump the
+ * counter, so they stay lock-free.
+ */
+
+static void s3fifo_init(cache_shard_t *sh) {
+    sh->target = main_capacity(sh) * POLICY_S3_SMALL_PERCENT / 100;
+    ghost_init(&sh->ghost[0], main_capacity(sh));
+}
+
+static void s3fifo_resize(cache_shard_t *sh) {
+    sh->target = main_capacity(sh) * POLICY_S3_SMALL_PERCENT / 100;
+    sh->ghost[0].max_bytes = main_capacity(sh);
+}
+
+static void s3fifo_insert(cache_shard_t *sh, cache_entry_t *e) {
+    policy_list_append(sh, ghost_take(&sh->ghost[0], e->hash) ? 1 : 0, e);
+}
+
+static void s3fifo_hit(cache_shard_t *sh, cache_entry_t *e) {
+    int f = __atomic_load_n(&e->freq, __ATOMIC_RELAXED);
+    if (f < POLICY_S3_MAX_FREQ) {
+        __atomic_store_n(&e->freq, f + 1, __ATOMIC_RELAXED); // 경쟁으로 한 번 덜 세어져도 무방
+    }
+}
+
+static cache_entry_t *s3fifo_victim(cache_shard_t *sh) {
+    cache_list_t *small = &sh->lists[0], *main = &sh->lists[1];
+    cache_entry_t *e;
+
+    for (;;) {
+        if (small->head != NULL && (small->bytes > sh->target || main->head == NULL)) {
+            e = small->head;
+            if (__atomic_load_n(&e->freq, __ATOMIC_RELAXED) == 0) {
+                return e;
+            }
+            __atomic_store_n(&e->freq, 0, __ATOMIC_RELAXED);
+            list_move(sh, 1, e); // small에서 다시 요청된 항목은 main으로 승격
+        } else if ((e = main->head) != NULL) {
+            int f = __atomic_load_n(&e->freq, __ATOMIC_RELAXED);
+            if (f == 0) {
+                return e;
+            }
+            __atomic_store_n(&e->freq, f - 1, __ATOMIC_RELAXED);
+            list_move(sh, 1, e);
+        } else {
+            return NULL;
+        }
+    }
+}
+
+static void s3fifo_remove(cache_shard_t *sh, cache_entry_t *e, int evicted) {
+    if (evicted && e->list == 0) {
+        ghost_add(&sh->ghost[0], e->hash, e->size);
+    }
+    policy_list_remove(sh, e);
+}
+
+static const cache_policy_t policies[] = {
+    { "fifo",   0, single_init, single_insert, fifo_hit,   fifo_victim,   single_remove, NULL },
+    { "clock",  0, single_init, single_insert, clock_hit,  clock_victim,  single_remove, NULL },
+    { "lru",    1, single_init, single_insert, lru_hit,    fifo_victim,   single_remove, NULL },
+    { "arc",    1, arc_init,    arc_insert,    arc_hit,    arc_victim,    arc_remove,    arc_resize },
+    { "s3fifo", 0, s3fifo_init, s3fifo_insert, s3fifo_hit, s3fifo_victim, s3fifo_remove, s3fifo_resize },
+};
+
+/* Look up a policy by name; returns NULL if there is none */
+const cache_policy_t *policy_find(const char *name) {
+    for (int i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (strcasecmp(policies[i].name, name) == 0) {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
+/* Names of all policies, for usage messages */
+const char *policy_names(void) {
+    return "fifo|clock|lru|arc|s3fifo";
+}
@@ -0,0 +1,70 @@
+/*
+ * policy.h - pluggable eviction policies for the cache shards
+ *
+ * A policy decides which entry of a shard leaves next. The shard code
+ * only calls the hooks below, always with the shard lock held except for
+ * on_hit, which runs on the lock-free lookup path unless the policy sets
+ * hit_locks. Policies keep their state in the shard's lists[], ghost[]
+ * and target fields; what each list means is up to the policy.
+ */
+#ifndef __POLICY_H__
+#define __POLICY_H__
+
+#define POLICY_LIST_NONE -1    /* Entry is not on any list */
+#define POLICY_LIST_WINDOW 2   /* lists[2] is the W-TinyLFU admission window */
+#define POLICY_NLISTS 3
+#define POLICY_NGHOSTS 2
+#define POLICY_S3_SMALL_PERCENT 10 /* S3-FIFO small queue share of the main space */
+#define POLICY_S3_MAX_FREQ 3       /* S3-FIFO frequency counters saturate here */
+
+struct cache_entry;
+struct cache_shard;
+
+/* Doubly linked list of entries, oldest at head */
+typedef struct {
+    struct cache_entry *head;
+    struct cache_entry *tail;
+    long bytes;               // 리스트에 있는 항목들의 size 합
+} cache_list_t;
+
+/* A ghost remembers the hashes of recently evicted entries, but not their bodies; its buckets are heap overhead to mem.h */
+typedef struct ghost_node {
+    unsigned long hash;
+    long size;
+    struct ghost_node *prev;  // FIFO 순서 (head가 가장 오래됨)
+    struct ghost_node *next;
+    struct ghost_node *hnext; // 같은 해시 버킷의 다음 노드
+} ghost_node_t;
+
+typedef struct {
+    ghost_node_t *head;
+    ghost_node_t *tail;
+    ghost_node_t **buckets;
+    int nbuckets;             // 2의 거듭제곱
+    long bytes;               // 기억하고 있는 항목들의 크기 합
+    long max_bytes;           // 넘으면 가장 오래된 기록부터 잊는다
+} ghost_t;
+
+typedef struct {
+    const char *name;
+    int hit_locks;            /* on_hit reorders lists and needs the shard lock */
+    void (*init)(struct cache_shard *sh);
+    /* An entry enters the policy's lists (after the window, if any) */
+    void (*on_insert)(struct cache_shard *sh, struct cache_entry *e);
+    /* A lookup hit e; e is pinned but may already be off every list */
+    void (*on_hit)(struct cache_shard *sh, struct cache_entry *e);
+    /* Return the next entry to evict, still linked, or NULL if none */
+    struct cache_entry *(*choose_victim)(struct cache_shard *sh);
+    /* Unlink e; evicted is set when it leaves because of choose_victim */
+    void (*on_remove)(struct cache_shard *sh, struct cache_entry *e, int evicted);
+    /* The shard's max_size changed; NULL if the policy sizes nothing from it */
+    void (*on_resize)(struct cache_shard *sh);
+} cache_policy_t;
+
+const cache_policy_t *policy_find(const char *name);
+const char *policy_names(void);
+void policy_list_append(struct cache_shard *sh, int list, struct cache_entry *e);
+void policy_list_remove(struct cache_shard *sh, struct cache_entry *e);
+void policy_ghost_drop(struct cache_shard *sh, void *lo, void *hi);
+
+#endif /* __POLICY_H__ */
@@ -0,0 +1,474 @@
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "csapp.h"
+#include "cache.h"
+#include "prefetch.h"
+
+/* Tokenizer states */
+enum {
+    PREFETCH_S_OFF,           /* Not an HTML page: the rest is ignored */
+    PREFETCH_S_HEADER,        /* Collecting the response header */
+    PREFETCH_S_TEXT,          /* Between tags */
+    PREFETCH_S_TAG_NAME,      /* After '<' */
+    PREFETCH_S_BANG,          /* After "<!" */
+    PREFETCH_S_COMMENT,       /* Inside "<!-- -->" */
+    PREFETCH_S_SKIP_TAG,      /* Rest of a tag that is not looked at */
+    PREFETCH_S_ATTRS,         /* Between attributes */
+    PREFETCH_S_ATTR_NAME,
+    PREFETCH_S_AFTER_NAME,    /* Attribute name read, maybe '=' next */
+    PREFETCH_S_BEFORE_VALUE,  /* After '=' */
+    PREFETCH_S_VALUE,
+    PREFETCH_S_RAW            /* Script or style text, up to its end tag */
+};
+
+static int enabled;
+static int query_order;
+static prefetch_fetch_t prefetch_fetch;
+
+/* Links between the scanning threads and the workers */
+static char *queue[PREFETCH_QUEUE_SIZE];
+static int qfront, qrear;
+static sem_t qmutex, qslots, qitems;
+
+static long pages, found, cached, queued, drops, fetched;
+
+/* Worker: fetch queued links one at a time, below the client threads' priority */
+static void *prefetch_worker(void *vargp) {
+    Pthread_detach(pthread_self());
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), PREFETCH_NICE); // Linux에서는 스레드마다 nice 값이 따로 있다
+    for (;;) {
+        P(&qitems);
+        P(&qmutex);
+        char *uri = queue[qfront];
+        qfront = (qfront + 1) % PREFETCH_QUEUE_SIZE;
+        V(&qmutex);
+        V(&qslots);
+        unsigned long hash = cache_hash(uri);
+        if (!cache_contains(uri, hash)) { // 기다리는 동안 브라우저가 먼저 가져갔을 수 있다
+            prefetch_fetch(uri, hash, NULL);
+            __atomic_fetch_add(&fetched, 1, __ATOMIC_RELAXED);
+        }
+        Free(uri);
+    }
+    return NULL;
+}
+
+/*
+ * prefetch_init - Start workers background fetchers; fetch gets a URI
+ *     into the cache, whose keys order query parameters by order (-Q).
+ *     Without workers nothing is scanned.
+ */
+void prefetch_init(int workers, int order, prefetch_fetch_t fetch) {
+    pthread_t tid;
+
+    if (workers <= 0) {
+        return;
+    }
+    query_order = order;
+    prefetch_fetch = fetch;
+    Sem_init(&qmutex, 0, 1);
+    Sem_init(&qslots, 0, PREFETCH_QUEUE_SIZE);
+    Sem_init(&qitems, 0, 0);
+    for (int i = 0; i < workers; i++) {
+        Pthread_create(&tid, NULL, prefetch_worker, NULL);
+    }
+    enabled = 1;
+}
+
+/* Start scanning the response to a client's request for uri; NULL when prefetching is off */
+prefetch_scan_t *prefetch_begin(const char *uri) {
+    prefetch_scan_t *s;
+
+    if (!enabled || strncmp(uri, "http://", 7) != 0) {
+        return NULL;
+    }
+    s = Malloc(sizeof(prefetch_scan_t));
+    s->state = PREFETCH_S_HEADER;
+    s->hlen = 0;
+    snprintf(s->base, sizeof(s->base), "%s", uri);
+    s->origin_len = 7 + strcspn(s->base + 7, "/?#");
+    s->url[0] = '\0';
+    s->rel_ok = 0;
+    s->links = 0;
+    return s;
+}
+
+void prefetch_end(prefetch_scan_t *s) {
+    if (s != NULL) {
+        Free(s);
+    }
+}
+
+/*
+ * remove_dots - Resolve "." and ".." segments of the path at path in place
+ *     (RFC 3986 5.2.4). Returns -1 if the result would not fit in MAXLINE.
+ */
+static int remove_dots(char *path) {
+    char out[MAXLINE];
+    const char *p = path;
+    int len = 0;
+
+    while (*p == '/') {
+        const char *seg = p + 1;
+        int k = strcspn(seg, "/");
+        if (k == 1 && seg[0] == '.') {
+            p = seg + 1;
+        } else if (k == 2 && seg[0] == '.' && seg[1] == '.') {
+            while (len > 0 && out[--len] != '/') {
+                // 마지막 세그먼트를 지운다
+            }
+            p = seg + 2;
+        } else {
+            if (len + k + 2 > (int)sizeof(out)) {
+                return -1; // 긴 페이지 경로와 긴 상대 링크가 합쳐졌다
+            }
+            memcpy(out + len, p, k + 1);
+            len += k + 1;
+            p = seg + k;
+            continue;
+        }
+        if (*p == '\0' && len + 2 <= (int)sizeof(out)) {
+            out[len++] = '/'; // "a/." 와 "a/.." 는 디렉터리를 가리킨다
+        }
+    }
+    if (len == 0) {
+        out[len++] = '/';
+    }
+    out[len] = '\0';
+    strcpy(path, out);
+    return 0;
+}
+
+/*
+ * resolve - Turn the link ref found on page s->base into a cache key in
+ *     out. Returns -1 unless it is an http:// URI on the page's origin.
+ */
+static int resolve(prefetch_scan_t *s, const char *ref, char *out, int size) {
+    char abs[2 * MAXLINE];
+    int dir;
+
+    if (ref[0] == '\0' || ref[0] == '#') {
+        return -1;
+    }
+    if (strncasecmp(ref, "http://", 7) == 0) {
+        snprintf(abs, sizeof(abs), "%s", ref);
+    } else if (ref[0] == '/' && ref[1] == '/') {
+        snprintf(abs, sizeof(abs), "http:%s", ref);
+    } else if (ref[0] == '/') {
+        snprintf(abs, sizeof(abs), "%.*s%s", s->origin_len, s->base, ref);
+    } else if (ref[strcspn(ref, ":/?#")] == ':') {
+        return -1; // https:, data:, javascript:, mailto: ...
+    } else if (ref[0] == '?') {
+        snprintf(abs, sizeof(abs), "%.*s%s", (int)strcspn(s->base, "?"), s->base, ref);
+    } else {
+        dir = strcspn(s->base, "?");
+        while (dir > s->origin_len && s->base[dir - 1] != '/') {
+            dir--;
+        }
+        snprintf(abs, sizeof(abs), "%.*s%s%s", dir, s->base, dir == s->origin_len ? "/" : "", ref);
+    }
+
+    abs[strcspn(abs, "#")] = '\0';
+    char *path = abs + 7 + strcspn(abs + 7, "/?");
+    if (*path == '/') {
+        char query[MAXLINE];
+        int plen = strcspn(path, "?");
+        if (snprintf(query, sizeof(query), "%s", path + plen) >= (int)sizeof(query)) {
+            return -1;
+        }
+        path[plen] = '\0';
+        if (remove_dots(path) < 0 ||
+            strlen(path) + strlen(query) >= sizeof(abs) - (path - abs)) {
+            return -1;
+        }
+        strcat(path, query);
+    }
+    if (http_normalize_uri(abs, out, size, query_order) < 0 ||
+        strncmp(out, s->base, s->origin_len) != 0 || out[s->origin_len] != '/') {
+        return -1;
+    }
+    return 0;
+}
+
+/* Queue the link ref unless it is elsewhere, already cached or over the page's quota */
+static void link_found(prefetch_scan_t *s, const char *ref) {
+    char uri[MAXLINE];
+
+    if (s->links >= PREFETCH_MAX_LINKS || resolve(s, ref, uri, sizeof(uri)) < 0 || strcmp(uri, s->base) == 0) {
+        return;
+    }
+    __atomic_fetch_add(&found, 1, __ATOMIC_RELAXED);
+    if (cache_contains(uri, cache_hash(uri))) {
+        __atomic_fetch_add(&cached, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    s->links++;
+    if (sem_trywait(&qslots) != 0) {
+        __atomic_fetch_add(&drops, 1, __ATOMIC_RELAXED); // 일꾼들이 밀려 있으면 버린다
+        return;
+    }
+    char *copy = Malloc(strlen(uri) + 1);
+    strcpy(copy, uri);
+    P(&qmutex);
+    queue[qrear] = copy;
+    qrear = (qrear + 1) % PREFETCH_QUEUE_SIZE;
+    V(&qmutex);
+    V(&qitems);
+    __atomic_fetch_add(&queued, 1, __ATOMIC_RELAXED);
+}
+
+/* The attribute holding the sub-resource URL of a tag, or NULL if it has none */
+static const char *link_attr(const char *tag) {
+    if (strcmp(tag, "img") == 0 || strcmp(tag, "script") == 0 || strcmp(tag, "iframe") == 0 ||
+        strcmp(tag, "embed") == 0 || strcmp(tag, "input") == 0) {
+        return "src";
+    }
+    if (strcmp(tag, "link") == 0) {
+        return "href";
+    }
+    return NULL;
+}
+
+/* Tags whose text is not HTML */
+static const char *raw_end(const char *tag) {
+    if (strcmp(tag, "script") == 0) {
+        return "</script";
+    }
+    if (strcmp(tag, "style") == 0) {
+        return "</style";
+    }
+    return NULL;
+}
+
+/* An attribute value is complete */
+static void attr_done(prefetch_scan_t *s) {
+    const char *want = link_attr(s->tag);
+
+    if (s->value_len == MAXLINE - 1) {
+        s->value_len = 0; // 잘린 값 (data: URL 등)은 버린다
+    }
+    s->value[s->value_len] = '\0';
+    if (want != NULL && strcmp(s->attr, want) == 0) {
+        int k = 0;
+        for (int i = 0; i < s->value_len; i++) {
+            s->url[k++] = s->value[i];
+            if (strncmp(s->value + i, "&amp;", 5) == 0) {
+                i += 4; // 속성 값 안의 "&amp;"는 '&'
+            }
+        }
+        s->url[k] = '\0';
+    } else if (strcmp(s->tag, "link") == 0 && strcmp(s->attr, "rel") == 0) {
+        s->rel_ok = http_has_token(s->value, "stylesheet") || http_has_token(s->value, "icon") ||
+                    http_has_token(s->value, "preload");
+    }
+}
+
+/* '>' closed a tag being looked at */
+static int tag_done(prefetch_scan_t *s) {
+    if (s->url[0] != '\0' && (strcmp(s->tag, "link") != 0 || s->rel_ok)) {
+        link_found(s, s->url);
+    }
+    s->url[0] = '\0';
+    s->rel_ok = 0;
+    if ((s->raw_end = raw_end(s->tag)) != NULL) {
+        s->raw_matched = 0;
+        return PREFETCH_S_RAW;
+    }
+    return PREFETCH_S_TEXT;
+}
+
+/* Wait for the complete response header; returns how many of the n bytes at buf it took */
+static int scan_header(prefetch_scan_t *s, const char *buf, int n) {
+    http_response_t resp;
+    int before = s->hlen, k = MIN(n, HTTP_MAX_HEADER - s->hlen);
+
+    memcpy(s->hdr + s->hlen, buf, k);
+    s->hlen += k;
+    if (http_parse_response(s->hdr, s->hlen, &resp) < 0) {
+        s->state = PREFETCH_S_OFF;
+        return n;
+    }
+    if (resp.header_len == 0) {
+        if (s->hlen == HTTP_MAX_HEADER) {
+            s->state = PREFETCH_S_OFF;
+        }
+        return n;
+    }
+    // 압축된 본문은 토큰화할 수 없으므로 그대로 둔다
+    if (resp.status != 200 || resp.encoding != HTTP_ENCODING_IDENTITY ||
+        strncasecmp(resp.content_type, "text/html", 9) != 0) {
+        s->state = PREFETCH_S_OFF;
+        return n;
+    }
+    __atomic_fetch_add(&pages, 1, __ATOMIC_RELAXED);
+    s->state = PREFETCH_S_TEXT;
+    return resp.header_len - before;
+}
+
+/*
+ * prefetch_scan - Feed the next n bytes of the response, status line
+ *     first. Tags may be split anywhere between calls. Only what the
+ *     links need is kept: tag and attribute names and the current value.
+ */
+void prefetch_scan(prefetch_scan_t *s, const char *buf, int n) {
+    const char *p = buf, *end = buf + n;
+
+    if (s == NULL || s->state == PREFETCH_S_OFF) {
+        return;
+    }
+    if (s->state == PREFETCH_S_HEADER) {
+        p += scan_header(s, buf, n);
+    }
+    while (p < end && s->state != PREFETCH_S_OFF) {
+        char c = *p++;
+        char lc = tolower((unsigned char)c);
+        int space = isspace((unsigned char)c);
+
+        switch (s->state) {
+        case PREFETCH_S_TEXT:
+            p--;
+            if ((p = memchr(p, '<', end - p)) == NULL) {
+                return; // 태그 사이의 텍스트는 한 번에 건너뛴다
+            }
+            p++;
+            s->tag_len = 0;
+            s->state = PREFETCH_S_TAG_NAME;
+            break;
+        case PREFETCH_S_TAG_NAME:
+            if (isalnum((unsigned char)c)) {
+                if (s->tag_len < PREFETCH_NAME_SIZE - 1) {
+                    s->tag[s->tag_len++] = lc;
+                }
+                break;
+            }
+            s->tag[s->tag_len] = '\0';
+            if (s->tag_len == 0) {
+                s->dashes = 0;
+                s->quote = 0;
+                if (c == '!') {
+                    s->state = PREFETCH_S_BANG;
+                } else if (c == '/' || c == '?') {
+                    s->state = PREFETCH_S_SKIP_TAG; // 닫는 태그와 처리 명령
+                } else if (c != '<') {
+                    s->state = PREFETCH_S_TEXT; // "a < b" 처럼 태그가 아닌 '<'
+                }
+            } else if (link_attr(s->tag) == NULL && raw_end(s->tag) == NULL) {
+                s->quote = 0;
+                s->state = c == '>' ? PREFETCH_S_TEXT : PREFETCH_S_SKIP_TAG;
+            } else {
+                s->state = c == '>' ? tag_done(s) : PREFETCH_S_ATTRS;
+            }
+            break;
+        case PREFETCH_S_BANG:
+            if (c == '-' && ++s->dashes == 2) {
+                s->dashes = 0;
+                s->state = PREFETCH_S_COMMENT;
+            } else if (c != '-') {
+                s->state = c == '>' ? PREFETCH_S_TEXT : PREFETCH_S_SKIP_TAG; // <!DOCTYPE ...>
+            }
+            break;
+        case PREFETCH_S_COMMENT:
+            if (c == '>' && s->dashes >= 2) {
+                s->state = PREFETCH_S_TEXT;
+            }
+            s->dashes = c == '-' ? s->dashes + 1 : 0;
+            break;
+        case PREFETCH_S_SKIP_TAG:
+            if (s->quote != 0) {
+                s->quote = c == s->quote ? 0 : s->quote;
+            } else if (c == '"' || c == '\'') {
+                s->quote = c;
+            } else if (c == '>') {
+                s->state = PREFETCH_S_TEXT;
+            }
+            break;
+        case PREFETCH_S_AFTER_NAME:
+            if (space) {
+                break;
+            }
+            if (c == '=') {
+                s->state = PREFETCH_S_BEFORE_VALUE;
+                break;
+            }
+            /* A new attribute without a value in between */
+            /* fall through */
+        case PREFETCH_S_ATTRS:
+            if (space || c == '/') {
+                s->state = PREFETCH_S_ATTRS;
+            } else if (c == '>') {
+                s->state = tag_done(s);
+            } else {
+                s->attr[0] = lc;
+                s->attr_len = 1;
+                s->state = PREFETCH_S_ATTR_NAME;
+            }
+            break;
+        case PREFETCH_S_ATTR_NAME:
+            if (c == '=') {
+                s->attr[s->attr_len] = '\0';
+                s->state = PREFETCH_S_BEFORE_VALUE;
+            } else if (space || c == '/') {
+                s->attr[s->attr_len] = '\0';
+                s->state = PREFETCH_S_AFTER_NAME;
+            } else if (c == '>') {
+                s->state = tag_done(s);
+            } else if (s->attr_len < PREFETCH_NAME_SIZE - 1) {
+                s->attr[s->attr_len++] = lc;
+            }
+            break;
+        case PREFETCH_S_BEFORE_VALUE:
+            if (space) {
+                break;
+            }
+            if (c == '>') {
+                s->state = tag_done(s);
+                break;
+            }
+            s->quote = c == '"' || c == '\'' ? c : 0;
+            s->value_len = 0;
+            if (s->quote == 0) {
+                s->value[s->value_len++] = c;
+            }
+            s->state = PREFETCH_S_VALUE;
+            break;
+        case PREFETCH_S_VALUE:
+            if (s->quote != 0 ? c == s->quote : space || c == '>') {
+                attr_done(s);
+                s->state = c == '>' ? tag_done(s) : PREFETCH_S_ATTRS;
+            } else if (s->value_len < MAXLINE - 1) {
+                s->value[s->value_len++] = c;
+            }
+            break;
+        case PREFETCH_S_RAW:
+            if (lc == s->raw_end[s->raw_matched]) {
+                if (s->raw_end[++s->raw_matched] == '\0') {
+                    s->quote = 0;
+                    s->state = PREFETCH_S_SKIP_TAG;
+                }
+            } else {
+                s->raw_matched = c == '<';
+            }
+            break;
+        }
+    }
+}
+
+/* Dump the prefetch counters with sio only */
+void prefetch_print_stats(void) {
+    if (!enabled) {
+        return;
+    }
+    Sio_puts("prefetch: pages=");
+    Sio_putl(pages);
+    Sio_puts(" links=");
+    Sio_putl(found);
+    Sio_puts(" cached=");
+    Sio_putl(cached);
+    Sio_puts(" queued=");
+    Sio_putl(queued);
+    Sio_puts(" dropped=");
+    Sio_putl(drops);
+    Sio_puts(" fetched=");
+    Sio_putl(fetched);
+    Sio_puts("\n");
+}
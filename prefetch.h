@@ -0,0 +1,54 @@
+/*
+ * prefetch.h - warming the cache with the sub-resources of HTML pages
+ *
+ * A browser that gets a page asks for its images, scripts and style
+ * sheets right after. While an HTML response streams from the origin to
+ * a client, a tokenizer picks the URLs of those sub-resources out of its
+ * tags without buffering the page. Links to the page's own origin are
+ * queued for a few background workers running at a lower priority, so
+ * the follow-up requests find them cached or join their fetch.
+ */
+#ifndef __PREFETCH_H__
+#define __PREFETCH_H__
+
+#include "csapp.h"
+#include "http.h"
+
+#define PREFETCH_QUEUE_SIZE 64    /* Links waiting for a worker; more are dropped */
+#define PREFETCH_MAX_LINKS 32     /* Links queued per page */
+#define PREFETCH_NICE 10          /* Workers run this much below the client threads */
+#define PREFETCH_NAME_SIZE 16     /* Longest tag or attribute name that is looked at */
+
+/* Tokenizer state for one response, fed as its bytes arrive */
+typedef struct {
+    int state;                /* PREFETCH_S_* in prefetch.c */
+    char hdr[HTTP_MAX_HEADER]; /* Response header, until it is complete */
+    int hlen;
+    char base[MAXLINE];       /* URI of the page, for relative links */
+    int origin_len;           /* Length of "http://host[:port]" in base */
+    char tag[PREFETCH_NAME_SIZE]; /* Current tag and attribute names, lower-cased */
+    int tag_len;
+    char attr[PREFETCH_NAME_SIZE];
+    int attr_len;
+    char value[MAXLINE];      /* Current attribute value */
+    int value_len;
+    char quote;               /* Quote around the value, 0 if unquoted */
+    int dashes;               /* '-' seen in a row, for "<!--" and "-->" */
+    char url[MAXLINE];        /* Link found in the current tag, queued when it ends */
+    int rel_ok;               /* <link>: rel names a resource the page loads */
+    const char *raw_end;      /* </script> or </style> ends the raw text */
+    int raw_matched;
+    int links;                /* Links queued for this page */
+} prefetch_scan_t;
+
+struct cache_entry;
+
+typedef void (*prefetch_fetch_t)(const char *uri, unsigned long hash, struct cache_entry *stale);
+
+void prefetch_init(int workers, int order, prefetch_fetch_t fetch);
+prefetch_scan_t *prefetch_begin(const char *uri);
+void prefetch_scan(prefetch_scan_t *scan, const char *buf, int n);
+void prefetch_end(prefetch_scan_t *scan);
+void prefetch_print_stats(void);
+
+#endif /* __PREFETCH_H__ */
@@ -1,32 +1,29 @@
 #include "csapp.h"
 #include "sbuf.h"
+#include "cache.h"
+#include "disk.h"
+#include "snapshot.h"
+#include "flight.h"
+#include "refresh.h"
+#include "codec.h"
+#include "dedup.h"
+#include "mem.h"
+#include "prefetch.h"
+#include "vary.h"
+#include "slab.h"
 
 #define NTHREADS 4
 #define SBUFSIZE 16
 
-/* Recommended max cache and object sizes */
-#define MAX_CACHE_SIZE 1024 * 1024 * 1024 * 5 /* 5 MB */
-#define MAX_OBJECT_SIZE 102400
-
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
-
 sbuf_t sbuf;
 
-typedef struct cache_entry {
-    char uri[MAXLINE];
-    char *content;
-    int content_length;
-    struct cache_entry *next;
-} cache_entry_t;
-
+/* Where relay_sink() sends the bytes it is given */
 typedef struct {
-    cache_entry_t *head;      // 가장 오래된 항목
-    cache_entry_t *tail;      // 가장 최근 항목
-    int total_size;           // 현재 캐시의 총 크기
-    sem_t sem;     // 동기화를 위한 뮤텍스
-} cache_t;
-
-cache_t cache;
+    int clientfd;
+    int *client_ok;
+    flight_t *flight;
+} relay_target_t;
+static int query_order = HTTP_QUERY_KEEP; /* -Q: how cache keys order query parameters */
 
 /* User-Agent header */
 static const char *user_agent_hdr =
@@ -38,6 +35,45 @@ int parse_uri(const char *uri, char *hostname, char *port, char *path);
 void forward_request(int clientfd);
 void handle_response(int serverfd, int clientfd);
 void send_error(int clientfd, int status, const char *short_msg, const char *long_msg);
+int format_error(char *resp, int status, const char *short_msg, const char *long_msg);
+void relay(int clientfd, int *client_ok, flight_t *flight, char *buf, int n);
+void relay_entry(int clientfd, int *client_ok, flight_t *flight, cache_entry_t *entry);
+int relay_sink(void *arg, const char *buf, int n);
+int conditional_headers(cache_entry_t *stale, char *buf, int size);
+void relay_response(int serverfd, int clientfd, flight_t *flight, cache_entry_t *stale, const char *uri,
+                    const char *fill, unsigned long fill_hash);
+int object_fits(const char *hdr, const http_response_t *resp);
+void refresh_fetch(const char *uri, unsigned long hash, cache_entry_t *stale);
+void leave_flight(flight_t *flight, int state);
+int read_request_headers(rio_t *rp, char *hdrs, int size);
+int serve_range(int fd, cache_entry_t *entry, const char *range, const char *if_range);
+int client_is_local(int fd);
+int is_conditional(const char *hdrs);
+void purge_request(int clientfd, char *uri, const char *hdrs);
+
+/* SIGUSR1 handler: print cache statistics */
+void sigusr1_handler(int sig) {
+    cache_print_stats();
+    disk_print_stats();
+    flight_print_stats();
+    refresh_print_stats();
+    codec_print_stats();
+    dedup_print_stats();
+    mem_print_stats();
+    slab_print_stats();
+    prefetch_print_stats();
+    vary_print_stats();
+}
+
+/* SIGUSR2 handler: checkpoint the cache now */
+void sigusr2_handler(int sig) {
+    snapshot_request(0);
+}
+
+/* SIGTERM/SIGINT handler: checkpoint the cache, then exit */
+void sigterm_handler(int sig) {
+    snapshot_request(1);
+}
 
 /* Thread routine */
 void thread(void* vargp) {
@@ -49,95 +85,29 @@ void thread(void* vargp) {
     }
 }
 
-void cache_init() {
-    cache.head = NULL;
-    cache.tail = NULL;
-    cache.total_size = 0;
-    if (sem_init(&cache.sem, 0, 1) != 0) { // 세마포어 초기화
-        perror("sem_init failed");
-        exit(1);
-    }
-}
-
-int cache_lookup(const char *uri, char **content, int *content_length) {
-    if (sem_wait(&cache.sem) < 0) { // 세마포어 대기 (잠금)
-        perror("sem_wait failed");
-        return 0;
-    }
-
-    cache_entry_t *current = cache.head;
-    while (current != NULL) {
-        if (strcmp(current->uri, uri) == 0) {
-            *content = current->content;
-            *content_length = current->content_length;
-            if (sem_post(&cache.sem) < 0) { // 세마포어 해제 (잠금 해제)
-                perror("sem_post failed");
-            }
-            return 1; // 캐시 히트
-        }
-        current = current->next;
-    }
-
-    if (sem_post(&cache.sem) < 0) { // 세마포어 해제 (잠금 해제)
-        perror("sem_post failed");
-    }
-    return 0; // 캐시 미스
-}
-
-
-void cache_insert(const char *uri, const char *content, int content_length) {
-    if (sem_wait(&cache.sem) < 0) { // 세마포어 대기 (잠금)
-        perror("sem_wait failed");
-        return;
-    }
-
-    // 캐시 용량 초과 시 FIFO 방식으로 항목 제거
-    while (cache.total_size + content_length > MAX_CACHE_SIZE) {
-        if (cache.head == NULL) {
-            break; // 캐시가 비어있다면 중단
-        }
-        cache_entry_t *old = cache.head;
-        cache.head = old->next;
-        cache.total_size -= old->content_length;
-        free(old->content);
-        free(old);
-    }
-
-    // 새로운 캐시 항목 생성
-    cache_entry_t *new_entry = malloc(sizeof(cache_entry_t));
-    if (new_entry == NULL) {
-        fprintf(stderr, "캐시 항목 메모리 할당 실패\n");
-        if (sem_post(&cache.sem) < 0) { // 세마포어 해제
-            perror("sem_post failed");
-        }
-        return;
-    }
-    strncpy(new_entry->uri, uri, MAXLINE);
-    new_entry->content = malloc(content_length);
-    if (new_entry->content == NULL) {
-        fprintf(stderr, "캐시 콘텐츠 메모리 할당 실패\n");
-        free(new_entry);
-        if (sem_post(&cache.sem) < 0) { // 세마포어 해제
-            perror("sem_post failed");
-        }
-        return;
-    }
-    memcpy(new_entry->content, content, content_length);
-    new_entry->content_length = content_length;
-    new_entry->next = NULL;
-
-    // 캐시에 항목 추가
-    if (cache.tail == NULL) {
-        cache.head = cache.tail = new_entry;
-    } else {
-        cache.tail->next = new_entry;
-        cache.tail = new_entry;
-    }
-    cache.total_size += content_length;
-
-    if (sem_post(&cache.sem) < 0) { // 세마포어 해제
-        perror("sem_post failed");
-    }
+/* Print command line usage and exit */
+void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-s shards] [-M mb] [-a 0|1] [-p policy] [-d dir [-D mb]] [-S file [-I secs]] [-T secs] [-N secs] [-E secs] [-Q keep|name|full] [-P n] <port>\n", prog);
+    fprintf(stderr, "  -s shards  number of cache shards (default %d)\n", CACHE_DEFAULT_SHARDS);
+    fprintf(stderr, "  -M mb      memory budget in megabytes; shrinks under memory pressure\n");
+    fprintf(stderr, "             (default %ld)\n", (long)MAX_CACHE_SIZE / (1024 * 1024));
+    fprintf(stderr, "  -a 0|1     W-TinyLFU admission filter (default 1)\n");
+    fprintf(stderr, "  -p policy  eviction policy: %s (default %s)\n", policy_names(), CACHE_DEFAULT_POLICY);
+    fprintf(stderr, "  -d dir     keep evicted objects in a disk tier under dir\n");
+    fprintf(stderr, "  -D mb      disk tier size in megabytes (default %d)\n", DISK_DEFAULT_MB);
+    fprintf(stderr, "  -S file    restore the cache from file and checkpoint it there on\n");
+    fprintf(stderr, "             SIGTERM, SIGINT and SIGUSR2\n");
+    fprintf(stderr, "  -I secs    also checkpoint every secs seconds\n");
+    fprintf(stderr, "  -T secs    lifetime of responses without freshness headers, 0 = until\n");
+    fprintf(stderr, "             evicted (default %d)\n", CACHE_DEFAULT_TTL);
+    fprintf(stderr, "  -N secs    lifetime of 404/410 responses, 0 = not cached (default %d)\n", CACHE_NEGATIVE_TTL);
+    fprintf(stderr, "  -E secs    lifetime of 5xx responses and origin connect failures,\n");
+    fprintf(stderr, "             0 = not cached (default %d)\n", CACHE_ERROR_TTL);
+    fprintf(stderr, "  -Q order   query parameters in cache keys: keep, sorted by name, or\n");
+    fprintf(stderr, "             sorted by full name=value (default keep)\n");
+    fprintf(stderr, "  -P n       prefetch the images, scripts and style sheets of HTML pages\n");
+    fprintf(stderr, "             with n background fetchers (default 0 = off)\n");
+    exit(1);
 }
 
 /* Main function: listens for incoming connections and forwards requests */
@@ -147,23 +117,138 @@ int main(int argc, char* argv[]) {
     socklen_t clientlen;
     struct sockaddr_storage clientaddr;
     pthread_t tid;
-
-    if (argc != 2) {
-        fprintf(stderr, "usage: %s <port>\n", argv[0]);
-        exit(1);
+    cache_config_t cfg = { CACHE_DEFAULT_SHARDS, MAX_CACHE_SIZE, 1, CACHE_DEFAULT_POLICY,
+                           CACHE_DEFAULT_TTL, CACHE_NEGATIVE_TTL, CACHE_ERROR_TTL };
+    char *disk_dir = NULL;
+    long disk_mb = DISK_DEFAULT_MB;
+    char *snap_file = NULL;
+    int snap_interval = 0;
+    int prefetchers = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:M:a:p:d:D:S:I:T:N:E:Q:P:")) != -1) {
+        switch (opt) {
+        case 's': /* Number of cache shards */
+            cfg.nshards = atoi(optarg);
+            if (cfg.nshards < 1) {
+                fprintf(stderr, "Invalid shard count: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'M': /* Memory budget */
+            cfg.max_size = atol(optarg) * 1024 * 1024;
+            if (cfg.max_size < 1) {
+                fprintf(stderr, "Invalid memory budget: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'a': /* W-TinyLFU admission filter on/off */
+            cfg.admission = atoi(optarg) != 0;
+            break;
+        case 'p': /* Eviction policy */
+            if (policy_find(optarg) == NULL) {
+                fprintf(stderr, "Unknown eviction policy: %s\n", optarg);
+                usage(argv[0]);
+            }
+            cfg.policy = optarg;
+            break;
+        case 'd': /* Disk tier directory */
+            disk_dir = optarg;
+            break;
+        case 'D': /* Disk tier size */
+            disk_mb = atol(optarg);
+            if (disk_mb < 1) {
+                fprintf(stderr, "Invalid disk tier size: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'S': /* Snapshot file */
+            snap_file = optarg;
+            break;
+        case 'I': /* Checkpoint interval */
+            snap_interval = atoi(optarg);
+            if (snap_interval < 0) {
+                fprintf(stderr, "Invalid checkpoint interval: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'T': /* Default freshness lifetime */
+            cfg.default_ttl = atol(optarg);
+            if (cfg.default_ttl < 0) {
+                fprintf(stderr, "Invalid default TTL: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'N': /* Negative caching lifetime */
+            cfg.negative_ttl = atol(optarg);
+            if (cfg.negative_ttl < 0) {
+                fprintf(stderr, "Invalid negative TTL: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'E': /* Error caching lifetime */
+            cfg.error_ttl = atol(optarg);
+            if (cfg.error_ttl < 0) {
+                fprintf(stderr, "Invalid error TTL: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'Q': /* Query parameter order in cache keys */
+            if (strcmp(optarg, "keep") == 0) {
+                query_order = HTTP_QUERY_KEEP;
+            } else if (strcmp(optarg, "name") == 0) {
+                query_order = HTTP_QUERY_SORT_NAME;
+            } else if (strcmp(optarg, "full") == 0) {
+                query_order = HTTP_QUERY_SORT_FULL;
+            } else {
+                fprintf(stderr, "Unknown query order: %s\n", optarg);
+                usage(argv[0]);
+            }
+            break;
+        case 'P': /* Prefetch workers */
+            prefetchers = atoi(optarg);
+            if (prefetchers < 0) {
+                fprintf(stderr, "Invalid prefetch worker count: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
     }
 
     /* Ignore SIGPIPE to prevent server from terminating when writing to a closed socket */
-    // Signal(SIGPIPE, SIG_IGN);
+    Signal(SIGPIPE, SIG_IGN);
+    Signal(SIGUSR1, sigusr1_handler);
 
-    listenfd = Open_listenfd(argv[1]);
+    listenfd = Open_listenfd(argv[optind]);
     if (listenfd < 0) {
         perror("Open_listenfd failed");
         exit(1);
     }
 
     sbuf_init(&sbuf, SBUFSIZE);
-    cache_init();
+    cache_init(&cfg);
+    mem_init(cfg.max_size);
+    flight_init();
+    vary_init();
+    refresh_init(refresh_fetch);
+    prefetch_init(prefetchers, query_order, refresh_fetch);
+    if (disk_dir != NULL && disk_init(disk_dir, disk_mb * 1024 * 1024) < 0) {
+        fprintf(stderr, "Failed to set up disk tier in %s\n", disk_dir);
+        exit(1);
+    }
+    if (snap_file != NULL) {
+        /* Warm restart: bodies stay in the mapped snapshot until first served */
+        printf("Restored %ld objects from %s\n", snapshot_load(snap_file), snap_file);
+        snapshot_init(snap_file, snap_interval);
+        Signal(SIGUSR2, sigusr2_handler);
+        Signal(SIGTERM, sigterm_handler);
+        Signal(SIGINT, sigterm_handler);
+    }
 
     for(int i=0; i<NTHREADS; i++) { /* Create worker threads */
         Pthread_create(&tid, NULL, thread, NULL);
@@ -220,25 +305,439 @@ int parse_uri(const char *uri, char *hostname, char *port, char *path) {
     return 0;
 }
 
+/* Build a complete error response in resp (MAXBUF bytes); returns its length */
+int format_error(char *resp, int status, const char *short_msg, const char *long_msg) {
+    char body[MAXLINE];
+
+    /* Build the HTTP response body */
+    snprintf(body, MAXLINE, "<html><title>%d %s</title>", status, short_msg);
+    snprintf(body + strlen(body), MAXLINE - strlen(body), "<body bgcolor=\"ffffff\">\r\n");
+    snprintf(body + strlen(body), MAXLINE - strlen(body), "%d %s\r\n", status, short_msg);
+    snprintf(body + strlen(body), MAXLINE - strlen(body), "<p>%s\r\n", long_msg);
+    snprintf(body + strlen(body), MAXLINE - strlen(body), "</body></html>\r\n");
+
+    /* Status line and headers in front of the body */
+    return snprintf(resp, MAXBUF, "HTTP/1.0 %d %s\r\nContent-Type: text/html\r\nContent-Length: %lu\r\n\r\n%s",
+                    status, short_msg, strlen(body), body);
+}
+
 /* Function to send an error response to the client */
 void send_error(int clientfd, int status, const char *short_msg, const char *long_msg) {
-    char buf[MAXLINE], body[MAXBUF];
+    char buf[MAXBUF];
 
-    /* Build the HTTP response body */
-    snprintf(body, MAXBUF, "<html><title>%d %s</title>", status, short_msg);
-    snprintf(body + strlen(body), MAXBUF - strlen(body), "<body bgcolor=\"ffffff\">\r\n");
-    snprintf(body + strlen(body), MAXBUF - strlen(body), "%d %s\r\n", status, short_msg);
-    snprintf(body + strlen(body), MAXBUF - strlen(body), "<p>%s\r\n", long_msg);
-    snprintf(body + strlen(body), MAXBUF - strlen(body), "</body></html>\r\n");
-
-    /* Print the HTTP response */
-    snprintf(buf, MAXLINE, "HTTP/1.0 %d %s\r\n", status, short_msg);
-    Rio_writen(clientfd, buf, strlen(buf));
-    snprintf(buf, MAXLINE, "Content-Type: text/html\r\n");
-    Rio_writen(clientfd, buf, strlen(buf));
-    snprintf(buf, MAXLINE, "Content-Length: %lu\r\n\r\n", strlen(body));
-    Rio_writen(clientfd, buf, strlen(buf));
-    Rio_writen(clientfd, body, strlen(body));
+    Rio_writen(clientfd, buf, format_error(buf, status, short_msg, long_msg));
+}
+
+/* Forward n response bytes to the client (while it is still there) and to the flight, if any */
+void relay(int clientfd, int *client_ok, flight_t *flight, char *buf, int n) {
+    /* Keep reading after our client leaves: followers still need the bytes */
+    if (*client_ok && rio_writen(clientfd, buf, n) < 0) {
+        fprintf(stderr, "Client went away during fetch\n");
+        *client_ok = 0;
+    }
+    if (flight != NULL) {
+        flight_append(flight, buf, n);
+    }
+}
+
+/* End the response on flight, if any, with state and leave it */
+void leave_flight(flight_t *flight, int state) {
+    if (flight != NULL) {
+        flight_finish(flight, state);
+        flight_release(flight);
+    }
+}
+
+/* codec_sink_t that relays inflated bytes to a relay_target_t */
+int relay_sink(void *arg, const char *buf, int n) {
+    relay_target_t *t = arg;
+
+    relay(t->clientfd, t->client_ok, t->flight, (char *)buf, n);
+    return 0;
+}
+
+/*
+ * relay_entry - Send a cached entry's stored response to the client and
+ *     the flight, then leave the flight. A gzip-encoded entry is sent
+ *     inflated, since followers may not accept gzip.
+ */
+void relay_entry(int clientfd, int *client_ok, flight_t *flight, cache_entry_t *entry) {
+    char buf[MAXLINE];
+    int n;
+
+    if (entry->gzip) {
+        relay_target_t target = { clientfd, client_ok, flight };
+        codec_inflate(entry, relay_sink, &target);
+    } else {
+        for (long off = 0; (n = cache_read(entry, off, buf, MAXLINE)) > 0; off += n) {
+            relay(clientfd, client_ok, flight, buf, n);
+        }
+    }
+    leave_flight(flight, FLIGHT_CACHED); // 이미 캐시에 있는 본문이므로 다시 넣지 않는다
+}
+
+/*
+ * conditional_headers - Build the If-None-Match / If-Modified-Since lines
+ *     that ask the origin whether a stale entry is still current. Returns
+ *     the length written to buf, 0 if the entry has no usable validators.
+ */
+int conditional_headers(cache_entry_t *stale, char *buf, int size) {
+    char hdr[HTTP_MAX_HEADER], date[HTTP_DATE_SIZE];
+    http_response_t resp;
+    int len = 0;
+
+    if (http_parse_response(hdr, cache_read(stale, 0, hdr, sizeof(hdr)), &resp) < 0) {
+        return 0;
+    }
+    if (resp.etag[0] != '\0') {
+        len += snprintf(buf + len, size - len, "If-None-Match: %s\r\n", resp.etag);
+    }
+    if (resp.last_modified != 0) {
+        http_format_date(resp.last_modified, date);
+        len += snprintf(buf + len, size - len, "If-Modified-Since: %s\r\n", date);
+    }
+    return len;
+}
+
+/*
+ * object_fits - Whether the whole object behind the response headers hdr
+ *     to a passed-through range request could be cached: the total of a
+ *     206's Content-Range, or a 200's Content-Length, leaves room for the
+ *     headers within MAX_OBJECT_SIZE.
+ */
+int object_fits(const char *hdr, const http_response_t *resp) {
+    char value[MAXLINE];
+    const char *total;
+    long length = -1;
+
+    if (resp->status == 206 && http_header_value(hdr, "Content-Range", value, sizeof(value)) &&
+        (total = strchr(value, '/')) != NULL && isdigit((unsigned char)total[1])) {
+        length = atol(total + 1); // "bytes a-b/*"이면 전체 크기를 알 수 없다
+    } else if (resp->status == 200 && http_header_value(hdr, "Content-Length", value, sizeof(value))) {
+        length = atol(value);
+    }
+    return length >= 0 && length + resp->header_len <= MAX_OBJECT_SIZE;
+}
+
+/*
+ * relay_response - Stream the origin's response on serverfd to clientfd
+ *     (-1 when there is no client) and to the flight (NULL for a response
+ *     that is not shared), then finish and leave the flight. When a stale entry was revalidated, the status
+ *     line is read first: a 304 refreshes the entry and its stored
+ *     response is sent instead. fill, if set, is the key of a range
+ *     request that missed; the whole object is then fetched in the
+ *     background unless the headers show it is too large to cache. A
+ *     page fetched for a client is scanned for sub-resources to prefetch
+ *     on the way.
+ */
+void relay_response(int serverfd, int clientfd, flight_t *flight, cache_entry_t *stale, const char *uri,
+                    const char *fill, unsigned long fill_hash) {
+    char buf[MAXLINE];
+    int n, client_ok = clientfd >= 0;
+    rio_t rio_temp;
+    /* Background fetches are not scanned, so prefetches never cascade */
+    prefetch_scan_t *scan = clientfd >= 0 ? prefetch_begin(uri) : NULL;
+
+    Rio_readinitb(&rio_temp, serverfd);
+
+    /* Revalidating or after a range miss: read the status line and headers first */
+    if (stale != NULL || fill != NULL) {
+        char hdr[HTTP_MAX_HEADER];
+        int hlen = 0;
+        http_response_t resp;
+
+        while (hlen <= HTTP_MAX_HEADER - MAXLINE && (n = rio_readlineb(&rio_temp, hdr + hlen, MAXLINE)) > 0) {
+            hlen += n;
+            if (strcmp(hdr + hlen - n, "\r\n") == 0 || strcmp(hdr + hlen - n, "\n") == 0) {
+                break; /* End of headers */
+            }
+        }
+        int parsed = http_parse_response(hdr, hlen, &resp) == 0;
+        if (stale != NULL && parsed && resp.status == 304) {
+            /* Unchanged: refresh the entry and send the stored response instead */
+            printf("Revalidated URI: %s\n", uri);
+            cache_revalidate(stale, hdr, hlen);
+            relay_entry(clientfd, &client_ok, flight, stale);
+            prefetch_end(scan);
+            return;
+        }
+        if (stale != NULL && parsed && resp.status >= 500) {
+            /* Origin error: keep serving the stale copy rather than caching the error */
+            printf("Origin error %d, serving stale URI: %s\n", resp.status, uri);
+            relay_entry(clientfd, &client_ok, flight, stale);
+            prefetch_end(scan);
+            return;
+        }
+        if (fill != NULL && parsed && object_fits(hdr, &resp)) {
+            refresh_fill(fill, fill_hash); // 잘라 줄 수 있게 객체 전체를 받아 둔다
+        }
+        relay(clientfd, &client_ok, flight, hdr, hlen); // 변경됨: 새 응답이 stale 항목을 대체한다
+        prefetch_scan(scan, hdr, hlen);
+    }
+
+    /* Read response headers and body */
+    while ((n = rio_readnb(&rio_temp, buf, MAXLINE)) > 0) {
+        relay(clientfd, &client_ok, flight, buf, n);
+        prefetch_scan(scan, buf, n);
+    }
+    prefetch_end(scan);
+
+    /* 완성된 응답만 캐시에 게시 (마지막 참여자가 flight_release에서 처리) */
+    leave_flight(flight, n == 0 ? FLIGHT_DONE : FLIGHT_FAILED);
+}
+
+/*
+ * refresh_fetch - Background fetch callback: get uri as the leader of a
+ *     flight with no client, so requests that miss meanwhile share the
+ *     fetch. stale, if set, is an entry still being served while stale;
+ *     it is revalidated when it has validators.
+ */
+void refresh_fetch(const char *uri, unsigned long hash, cache_entry_t *stale) {
+    char host[MAXLINE], port_num[MAXLINE], path_buf[MAXLINE], buf[3 * MAXLINE], base[MAXLINE];
+    flight_t *flight;
+    int serverfd, leader, len;
+    const char *variant = strchr(uri, '\n');
+
+    /* A variant key is the URI followed by the request headers that select the variant */
+    snprintf(base, sizeof(base), "%.*s", variant != NULL ? (int)(variant - uri) : MAXLINE, uri);
+    if (parse_uri(base, host, port_num, path_buf) < 0) {
+        return;
+    }
+    if ((flight = flight_begin(uri, hash, 0, NULL, &leader)) == NULL) {
+        return; // 그 사이 새 응답이 캐시에 들어왔다
+    }
+    if (!leader) {
+        flight_release(flight); // 이미 다른 요청이 가져오는 중
+        return;
+    }
+    if ((serverfd = open_clientfd(host, port_num)) < 0) {
+        fprintf(stderr, "Background fetch failed to connect: %s\n", base);
+        leave_flight(flight, FLIGHT_FAILED);
+        return;
+    }
+
+    len = snprintf(buf, sizeof(buf), "GET %s HTTP/1.0\r\nHost: %s\r\n%s"
+                   "Connection: close\r\nProxy-Connection: close\r\n",
+                   path_buf, host, user_agent_hdr);
+    for (const char *p = variant; p != NULL && len < (int)sizeof(buf); p = strchr(p + 1, '\n')) {
+        int k = strcspn(p + 1, "\n");
+        if (p[k] != ':') { // 값이 비어 있으면 원래 요청에 그 헤더가 없었다
+            len += snprintf(buf + len, sizeof(buf) - len, "%.*s\r\n", k, p + 1);
+        }
+    }
+    if (stale != NULL && !stale->revalidate) {
+        stale = NULL; // 검증자가 없으면 그냥 다시 받는다
+    }
+    if (stale != NULL) {
+        len += conditional_headers(stale, buf + len, sizeof(buf) - len - 2);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "\r\n");
+    if (rio_writen(serverfd, buf, len) < 0) {
+        leave_flight(flight, FLIGHT_FAILED);
+    } else {
+        printf("Background fetch of URI: %s\n", base);
+        relay_response(serverfd, -1, flight, stale, base, NULL, 0);
+    }
+    Close(serverfd);
+}
+
+/*
+ * read_request_headers - Read the client's header block into hdrs (size
+ *     bytes, NUL-terminated) so that it can be looked at before the cache
+ *     lookup and forwarded on a miss. Lines that do not fit are dropped.
+ *     Returns the length.
+ */
+int read_request_headers(rio_t *rp, char *hdrs, int size) {
+    char buf[MAXLINE];
+    int len = 0, n;
+
+    hdrs[0] = '\0';
+    while ((n = Rio_readlineb(rp, buf, MAXLINE)) > 0) {
+        /* End of headers */
+        if (strcmp(buf, "\r\n") == 0 || strcmp(buf, "\n") == 0) {
+            break;
+        }
+        if (len + n < size) {
+            memcpy(hdrs + len, buf, n + 1);
+            len += n;
+        }
+    }
+    return len;
+}
+
+/*
+ * serve_range - Answer a Range request from a cached full response: one
+ *     range as a 206 with Content-Range, several as multipart/byteranges
+ *     and none satisfiable as a 416. Returns 0 without sending anything
+ *     when the range does not apply (the stored response is not a 200 or
+ *     is our gzip copy, If-Range does not match, the header is malformed) and the whole
+ *     object should be sent instead.
+ */
+int serve_range(int fd, cache_entry_t *entry, const char *range, const char *if_range) {
+    char hdr[HTTP_MAX_HEADER], out[HTTP_MAX_HEADER + MAXLINE], ctype[MAXLINE], boundary[32];
+    http_response_t resp;
+    http_range_t ranges[HTTP_MAX_RANGES];
+    int hlen = cache_read(entry, 0, hdr, sizeof(hdr) - 1), len, n;
+    long total;
+
+    if (entry->gzip) {
+        return 0; // 압축본의 바이트 위치는 원본과 다르므로 섞어 보낼 수 없다
+    }
+    if (http_parse_response(hdr, hlen, &resp) < 0 || resp.status != 200 || resp.header_len == 0) {
+        return 0;
+    }
+    hdr[resp.header_len] = '\0';
+    total = entry->content_length - resp.header_len;
+
+    /* If-Range: only a strong ETag or the exact Last-Modified date keeps the range */
+    if (if_range[0] != '\0' &&
+        !(if_range[0] == '"' && strcmp(if_range, resp.etag) == 0) &&
+        !(resp.last_modified != 0 && http_parse_date(if_range) == resp.last_modified)) {
+        return 0;
+    }
+    if ((n = http_parse_range(range, total, ranges)) < 0) {
+        return 0;
+    }
+    if (n == 0) {
+        len = snprintf(out, sizeof(out), "HTTP/1.0 416 Range Not Satisfiable\r\n"
+                       "Content-Range: bytes */%ld\r\nContent-Length: 0\r\n\r\n", total);
+        rio_writen(fd, out, len);
+        return 1;
+    }
+
+    /* The stored headers, minus those describing the whole body */
+    http_header_value(hdr, "Content-Type", ctype, sizeof(ctype));
+    len = snprintf(out, sizeof(out), "HTTP/1.0 206 Partial Content\r\n");
+    for (char *line = strchr(hdr, '\n') + 1, *eol; (eol = strchr(line, '\n')) != NULL; line = eol + 1) {
+        if (eol - line <= 1) {
+            break; /* End of headers */
+        }
+        if (strncasecmp(line, "Content-Length:", 15) == 0 || strncasecmp(line, "Content-Range:", 14) == 0 ||
+            (n > 1 && strncasecmp(line, "Content-Type:", 13) == 0)) {
+            continue;
+        }
+        memcpy(out + len, line, eol + 1 - line);
+        len += eol + 1 - line;
+    }
+
+    if (n == 1) {
+        long count = ranges[0].last - ranges[0].first + 1;
+        len += snprintf(out + len, sizeof(out) - len, "Content-Range: bytes %ld-%ld/%ld\r\nContent-Length: %ld\r\n\r\n",
+                        ranges[0].first, ranges[0].last, total, count);
+        if (rio_writen(fd, out, len) < 0) {
+            return 1;
+        }
+        cache_write_range(fd, entry, resp.header_len + ranges[0].first, count);
+        return 1;
+    }
+
+    /* 여러 범위: 각 부분에 자체 헤더를 붙인 multipart/byteranges */
+    snprintf(boundary, sizeof(boundary), "%016lx", entry->hash);
+    long body = snprintf(NULL, 0, "\r\n--%s--\r\n", boundary);
+    for (int i = 0; i < n; i++) {
+        body += snprintf(NULL, 0, "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %ld-%ld/%ld\r\n\r\n",
+                         boundary, ctype, ranges[i].first, ranges[i].last, total);
+        body += ranges[i].last - ranges[i].first + 1;
+    }
+    len += snprintf(out + len, sizeof(out) - len, "Content-Type: multipart/byteranges; boundary=%s\r\n"
+                    "Content-Length: %ld\r\n\r\n", boundary, body);
+    if (rio_writen(fd, out, len) < 0) {
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        len = snprintf(out, sizeof(out), "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %ld-%ld/%ld\r\n\r\n",
+                       boundary, ctype, ranges[i].first, ranges[i].last, total);
+        if (rio_writen(fd, out, len) < 0 ||
+            cache_write_range(fd, entry, resp.header_len + ranges[i].first, ranges[i].last - ranges[i].first + 1) < 0) {
+            return 1;
+        }
+    }
+    len = snprintf(out, sizeof(out), "\r\n--%s--\r\n", boundary);
+    rio_writen(fd, out, len);
+    return 1;
+}
+
+/* Whether the peer of fd is on this host: only local clients may purge */
+int client_is_local(int fd) {
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+
+    if (getpeername(fd, (struct sockaddr *)&addr, &len) < 0) {
+        return 0;
+    }
+    if (addr.ss_family == AF_INET) {
+        return ntohl(((struct sockaddr_in *)&addr)->sin_addr.s_addr) >> 24 == 127;
+    }
+    if (addr.ss_family == AF_INET6) {
+        struct in6_addr *a = &((struct sockaddr_in6 *)&addr)->sin6_addr;
+        return IN6_IS_ADDR_LOOPBACK(a) || (IN6_IS_ADDR_V4MAPPED(a) && a->s6_addr[12] == 127);
+    }
+    return 0;
+}
+
+/* Whether the client's own validators make its request conditional (a 304 or 412 may come back) */
+int is_conditional(const char *hdrs) {
+    static const char *names[] = { "If-None-Match", "If-Modified-Since", "If-Match", "If-Unmodified-Since" };
+    char value[MAXLINE];
+
+    for (int i = 0; i < 4; i++) {
+        if (http_header_value(hdrs, names[i], value, sizeof(value))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * purge_request - Answer a PURGE from a local client by invalidating
+ *     objects in RAM and on disk at once. The request URI names one
+ *     object, or every object under a prefix when it ends in '*'. With a
+ *     Surrogate-Key request header, every object the origin tagged with
+ *     one of its keys goes instead. Replies 200 if anything was purged
+ *     and 404 otherwise, with the counts in the body.
+ */
+void purge_request(int clientfd, char *uri, const char *hdrs) {
+    char keys[MAXLINE], key[MAXLINE], out[MAXBUF], *save, *tok;
+    long mem = 0, disk = 0;
+    int len = strlen(uri);
+
+    if (!client_is_local(clientfd)) {
+        send_error(clientfd, 403, "Forbidden", "PURGE is only accepted from this host");
+        return;
+    }
+    if (http_header_value(hdrs, "Surrogate-Key", keys, sizeof(keys))) {
+        for (tok = strtok_r(keys, " ,\t", &save); tok != NULL; tok = strtok_r(NULL, " ,\t", &save)) {
+            mem += cache_purge_tag(tok);
+            disk += disk_purge_tag(tok);
+        }
+    } else if (len > 0 && uri[len - 1] == '*') {
+        uri[len - 1] = '\0';
+        /* Cache keys are normalised; a prefix can be too once it reaches into the path */
+        char *host = strstr(uri, "://");
+        if (host != NULL && strchr(host + 3, '/') != NULL && strchr(uri, '?') == NULL &&
+            http_normalize_uri(uri, key, sizeof(key), query_order) >= 0) {
+            strcpy(uri, key);
+        }
+        mem = cache_purge_prefix(uri);
+        disk = disk_purge_prefix(uri);
+    } else {
+        if (http_normalize_uri(uri, key, sizeof(key), query_order) >= 0) {
+            strcpy(uri, key);
+        }
+        unsigned long hash = cache_hash(uri);
+        mem = cache_purge(uri, hash);
+        disk = disk_purge(uri, hash);
+        /* Its variants are keyed by the URI and a line per varying header */
+        snprintf(key, sizeof(key), "%s\n", uri);
+        mem += cache_purge_prefix(key);
+        disk += disk_purge_prefix(key);
+    }
+    printf("Purged %ld in memory and %ld on disk: %s\n", mem, disk, uri);
+
+    snprintf(key, sizeof(key), "purged memory=%ld disk=%ld\n", mem, disk);
+    len = snprintf(out, sizeof(out), "HTTP/1.0 %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n\r\n%s",
+                   mem + disk > 0 ? "200 OK" : "404 Not Found", strlen(key), key);
+    rio_writen(clientfd, out, len);
 }
 
 void forward_request(int clientfd) {
@@ -247,8 +746,11 @@ void forward_request(int clientfd) {
     char host[MAXLINE], port_num[MAXLINE], path_buf[MAXLINE];
     rio_t rio_client;
     int serverfd;
-    char *cache_content;
-    int cache_content_length;
+    char hdrs[HTTP_MAX_HEADER], range[MAXLINE], if_range[MAXLINE], accept[MAXLINE];
+    cache_entry_t *entry, *stale = NULL;
+    unsigned long uri_hash;
+    flight_t *flight;
+    int rc, leader = 1, gzip_ok, conditional;
 
     /* Initialize rio for client */
     Rio_readinitb(&rio_client, clientfd);
@@ -267,17 +769,103 @@ void forward_request(int clientfd) {
         return;
     }
 
-    /* Only handle GET method */
+    /* PURGE invalidates cached objects instead of fetching one */
+    if (strcasecmp(method_buf, "PURGE") == 0) {
+        read_request_headers(&rio_client, hdrs, sizeof(hdrs));
+        purge_request(clientfd, uri, hdrs);
+        return;
+    }
+
+    /* Otherwise only handle GET method */
     if (strcasecmp(method_buf, "GET")) {
         fprintf(stderr, "Unsupported method: %s\n", method_buf);
         send_error(clientfd, 501, "Not Implemented", "Proxy does not implement this method");
         return;
     }
 
+    /* The headers decide how a hit is served, so read them before the lookup */
+    read_request_headers(&rio_client, hdrs, sizeof(hdrs));
+    http_header_value(hdrs, "Range", range, sizeof(range));
+    http_header_value(hdrs, "If-Range", if_range, sizeof(if_range));
+    http_header_value(hdrs, "Accept-Encoding", accept, sizeof(accept));
+    gzip_ok = http_accepts_encoding(accept, "gzip");
+    conditional = is_conditional(hdrs);
+
+    /* Canonical cache key: equivalent spellings of a URL share one entry */
+    char key[MAXLINE];
+    if (http_normalize_uri(uri, key, sizeof(key), query_order) >= 0) {
+        strcpy(uri, key); // 이후 origin 요청도 정규화된 URI로 보낸다
+    }
+
+    /* Responses that vary by request header are cached per variant of the URI */
+    char vary[HTTP_MAX_VARY];
+    int keyed = 1;
+    strcpy(key, uri);
+    if (vary_lookup(uri, cache_hash(uri), vary)) {
+        keyed = http_variant_key(uri, vary, hdrs, key, sizeof(key)) >= 0;
+    }
+
     /* 캐시 조회 */
-    if (cache_lookup(uri, &cache_content, &cache_content_length)) {
-        printf("Cache hit for URI: %s\n", uri);
-        Rio_writen(clientfd, cache_content, cache_content_length);
+    uri_hash = cache_hash(key);
+    do {
+        /* A variant whose key does not fit is passed through uncached */
+        if (!keyed) {
+            flight = NULL;
+            break;
+        }
+        if ((entry = cache_lookup(key, uri_hash)) != NULL) {
+            printf("Cache hit for URI: %s\n", uri);
+            /* Expired but inside stale-while-revalidate: serve it now, refresh in the background */
+            if (cache_claim_refresh(entry)) {
+                refresh_request(entry);
+            }
+            /* The entry is pinned, so a slow client only holds its own reference */
+            if (entry->gzip && !gzip_ok) {
+                /* Stored compressed: inflate for this client (whole object, Range is ignored) */
+                if (codec_inflate(entry, codec_write_fd, &clientfd) < 0) {
+                    fprintf(stderr, "Client went away during cache hit: %s\n", uri);
+                }
+            } else if (range[0] != '\0' && serve_range(clientfd, entry, range, if_range)) {
+                printf("Range %s served from cache\n", range);
+            } else if (cache_write(clientfd, entry) < 0) {
+                fprintf(stderr, "Client went away during cache hit: %s\n", uri);
+            }
+            cache_release(entry);
+            return;
+        }
+        /* Range or conditional miss: the answer is not the whole object, so pass the
+           request through instead of sharing it (a range miss may fill the object later) */
+        if (range[0] != '\0' || conditional) {
+            flight = NULL;
+            break;
+        }
+        if ((rc = disk_serve(clientfd, key, uri_hash, gzip_ok)) != 0) {
+            printf("Disk hit for URI: %s\n", uri);
+            if (rc < 0) {
+                fprintf(stderr, "Client went away during disk hit: %s\n", uri);
+            }
+            return;
+        }
+        /* NULL means a flight for this URI just landed in the cache */
+    } while ((flight = flight_begin(key, uri_hash, gzip_ok, hdrs, &leader)) == NULL);
+
+    /* A response that turns out to vary by a header this client sent differently is not shared */
+    if (flight != NULL && !leader && !flight_vary_ok(flight, hdrs)) {
+        printf("In-flight fetch is another variant of URI: %s\n", uri);
+        flight_release(flight);
+        flight = NULL;
+    }
+
+    /* 같은 URI를 이미 가져오는 중이면 origin에 가지 않고 그 응답을 함께 받는다 */
+    if (flight != NULL && !leader) {
+        printf("Joined in-flight fetch for URI: %s\n", uri);
+        rc = flight_follow(flight, clientfd);
+        flight_release(flight);
+        if (rc == 0) {
+            send_error(clientfd, 502, "Bad Gateway", "Origin fetch failed");
+        } else if (rc < 0) {
+            fprintf(stderr, "In-flight fetch incomplete for URI: %s\n", uri);
+        }
         return;
     }
 
@@ -285,14 +873,34 @@ void forward_request(int clientfd) {
     if (parse_uri(uri, host, port_num, path_buf) < 0) {
         fprintf(stderr, "Failed to parse URI: %s\n", uri);
         send_error(clientfd, 400, "Bad Request", "Failed to parse URI");
+        leave_flight(flight, FLIGHT_FAILED);
         return;
     }
 
-    /* Connect to the target server */
-    serverfd = Open_clientfd(host, port_num);
+    /* 만료됐지만 검증자가 있는 사본이 있으면 다시 받지 않고 origin에 변경 여부만 묻는다 */
+    char cond_hdrs[MAXLINE];
+    int cond_len = 0;
+    if (flight != NULL && (stale = cache_lookup_stale(key, uri_hash)) != NULL &&
+        (cond_len = conditional_headers(stale, cond_hdrs, sizeof(cond_hdrs))) == 0) {
+        cache_release(stale);
+        stale = NULL;
+    }
+
+    /* Connect to the target server (without exiting when it is unreachable) */
+    serverfd = open_clientfd(host, port_num);
     if (serverfd < 0) {
-        fprintf(stderr, "Connection to server failed.\n");
-        send_error(clientfd, 502, "Bad Gateway", "Failed to connect to server");
+        fprintf(stderr, "Connection to server failed: %s\n", uri);
+        int client_ok = 1;
+        if (stale != NULL) {
+            /* A stale copy beats an error; it is not replaced by one */
+            relay_entry(clientfd, &client_ok, flight, stale);
+            cache_release(stale);
+            return;
+        }
+        /* The 502 goes through the flight like a response, so it is cached for the error TTL */
+        char resp[MAXBUF];
+        relay(clientfd, &client_ok, flight, resp, format_error(resp, 502, "Bad Gateway", "Failed to connect to server"));
+        leave_flight(flight, FLIGHT_DONE);
         return;
     }
 
@@ -306,16 +914,22 @@ void forward_request(int clientfd) {
 
     /* Forward headers */
     int host_present = 0;
-    while (Rio_readlineb(&rio_client, buf, MAXLINE) > 0) {
-        /* End of headers */
-        if (strcmp(buf, "\r\n") == 0) {
-            break;
-        }
+    for (char *line = hdrs, *eol; (eol = strchr(line, '\n')) != NULL; line = eol + 1) {
+        int n = eol + 1 - line;
+        memcpy(buf, line, n);
+        buf[n] = '\0';
 
         /* Skip headers that need to be replaced */
         if (strncasecmp(buf, "User-Agent:", 11) == 0 ||
             strncasecmp(buf, "Connection:", 11) == 0 ||
-            strncasecmp(buf, "Proxy-Connection:", 17) == 0) {
+            strncasecmp(buf, "Proxy-Connection:", 17) == 0 ||
+            strncasecmp(buf, "Accept-Encoding:", 16) == 0) {
+            continue;
+        }
+
+        /* The client's own validators are replaced by the cached entry's */
+        if (stale != NULL && (strncasecmp(buf, "If-None-Match:", 14) == 0 ||
+                              strncasecmp(buf, "If-Modified-Since:", 18) == 0)) {
             continue;
         }
 
@@ -337,37 +951,20 @@ void forward_request(int clientfd) {
     }
     Rio_writen(serverfd, "Connection: close\r\n", 19);
     Rio_writen(serverfd, "Proxy-Connection: close\r\n", 25);
-    Rio_writen(serverfd, "\r\n", 2); /* End of headers */
-
-    /* Handle the response from the server and send it back to the client */
-    // 응답을 메모리에 저장하여 캐시에 추가
-    // 이를 위해 응답을 버퍼에 저장해야 합니다.
-
-    // 임시 버퍼
-    char *response_buf = malloc(MAX_CACHE_SIZE);
-    if (response_buf == NULL) {
-        fprintf(stderr, "메모리 할당 실패\n");
-        Close(serverfd);
-        return;
+    /* Only gzip or identity reach the cache, which serves either to every client */
+    if (gzip_ok) {
+        Rio_writen(serverfd, "Accept-Encoding: gzip\r\n", 23);
     }
-    int total_received = 0;
-    int n;
-
-    rio_t rio_temp;
-    Rio_readinitb(&rio_temp, serverfd);
-
-    /* Read response headers and body */
-    while ((n = Rio_readnb(&rio_temp, buf, MAXLINE)) > 0) {
-        Rio_writen(clientfd, buf, n);
-        if (total_received + n <= MAX_CACHE_SIZE) {
-            memcpy(response_buf + total_received, buf, n);
-            total_received += n;
-        }
+    if (stale != NULL) {
+        Rio_writen(serverfd, cond_hdrs, cond_len);
     }
+    Rio_writen(serverfd, "\r\n", 2); /* End of headers */
 
-    /* 캐시에 저장 */
-    cache_insert(uri, response_buf, total_received);
-    free(response_buf);
+    /* Forward the response while buffering it for followers and the cache */
+    relay_response(serverfd, clientfd, flight, stale, uri, flight == NULL && keyed && range[0] != '\0' ? key : NULL, uri_hash);
+    if (stale != NULL) {
+        cache_release(stale);
+    }
 
     Close(serverfd);
 }
@@ -0,0 +1,286 @@
+#include "csapp.h"
+#include "cache.h"
+#include "purge.h"
+
+void purge_index_init(purge_index_t *idx) {
+    memset(idx, 0, sizeof(*idx));
+}
+
+static radix_node_t *node_new(purge_index_t *idx, radix_node_t *parent, const char *label, int len) {
+    radix_node_t *n = Malloc(sizeof(radix_node_t));
+
+    n->label = Malloc(len);
+    memcpy(n->label, label, len);
+    n->len = len;
+    n->item = NULL;
+    n->parent = parent;
+    n->child = n->sibling = NULL;
+    idx->bytes += sizeof(radix_node_t) + len;
+    return n;
+}
+
+static void node_free(purge_index_t *idx, radix_node_t *n) {
+    idx->bytes -= sizeof(radix_node_t) + n->len;
+    Free(n->label);
+    Free(n);
+}
+
+/* The child of node whose label starts with c; labels of siblings never share a first byte */
+static radix_node_t *child_for(radix_node_t *node, char c) {
+    radix_node_t *ch = node->child;
+
+    while (ch != NULL && ch->label[0] != c) {
+        ch = ch->sibling;
+    }
+    return ch;
+}
+
+/* Put n in old's place among the children of parent */
+static void child_replace(radix_node_t *parent, radix_node_t *old, radix_node_t *n) {
+    radix_node_t **pp = &parent->child;
+
+    while (*pp != old) {
+        pp = &(*pp)->sibling;
+    }
+    n->sibling = old->sibling;
+    *pp = n;
+}
+
+/* Length of the common prefix of the label a (n bytes) and the string b */
+static int common(const char *a, int n, const char *b) {
+    int k = 0;
+
+    while (k < n && a[k] == b[k]) {
+        k++;
+    }
+    return k;
+}
+
+/* Find the node for uri, adding and splitting nodes as needed */
+static radix_node_t *radix_insert(purge_index_t *idx, const char *uri) {
+    radix_node_t *node = &idx->root;
+    const char *p = uri;
+
+    while (*p != '\0') {
+        radix_node_t *c = child_for(node, *p);
+        if (c == NULL) {
+            c = node_new(idx, node, p, strlen(p));
+            c->sibling = node->child;
+            node->child = c;
+            return c;
+        }
+        int k = common(c->label, c->len, p);
+        if (k < c->len) {
+            // 라벨 중간에서 갈라지므로 공통 부분을 새 중간 노드로 뗀다
+            radix_node_t *mid = node_new(idx, node, c->label, k);
+            char *rest = Malloc(c->len - k);
+            memcpy(rest, c->label + k, c->len - k);
+            Free(c->label);
+            child_replace(node, c, mid);
+            c->label = rest;
+            c->len -= k;
+            c->parent = mid;
+            c->sibling = NULL;
+            mid->child = c;
+            idx->bytes -= k;
+            c = mid;
+        }
+        node = c;
+        p += k;
+    }
+    return node;
+}
+
+/*
+ * radix_remove - Clear node's item, then free the nodes that no longer
+ *     lead to any item and merge a node left with a single child into
+ *     it, so every inner node still branches.
+ */
+static void radix_remove(purge_index_t *idx, radix_node_t *node) {
+    node->item = NULL;
+    while (node != &idx->root && node->item == NULL && node->child == NULL) {
+        radix_node_t *parent = node->parent, **pp = &parent->child;
+        while (*pp != node) {
+            pp = &(*pp)->sibling;
+        }
+        *pp = node->sibling;
+        node_free(idx, node);
+        node = parent;
+    }
+    if (node != &idx->root && node->item == NULL && node->child != NULL && node->child->sibling == NULL) {
+        radix_node_t *c = node->child;
+        char *label = Malloc(node->len + c->len);
+        memcpy(label, node->label, node->len);
+        memcpy(label + node->len, c->label, c->len);
+        Free(c->label);
+        c->label = label;
+        c->len += node->len;
+        c->parent = node->parent;
+        child_replace(node->parent, node, c);
+        idx->bytes += node->len;
+        node_free(idx, node);
+    }
+}
+
+/* Find the tag called name, creating it if create is set */
+static purge_tag_t *tag_find(purge_index_t *idx, const char *name, int create) {
+    unsigned long hash = cache_hash(name);
+    purge_tag_t **bucket = &idx->tags[hash % PURGE_TAG_BUCKETS], *t;
+
+    for (t = *bucket; t != NULL; t = t->hnext) {
+        if (t->hash == hash && strcmp(t->name, name) == 0) {
+            return t;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    int len = strlen(name);
+    t = Malloc(sizeof(purge_tag_t) + len + 1);
+    t->hash = hash;
+    t->links = NULL;
+    memcpy(t->name, name, len + 1);
+    t->hnext = *bucket;
+    *bucket = t;
+    idx->bytes += sizeof(purge_tag_t) + len + 1;
+    return t;
+}
+
+static void tag_free(purge_index_t *idx, purge_tag_t *t) {
+    purge_tag_t **pp = &idx->tags[t->hash % PURGE_TAG_BUCKETS];
+
+    while (*pp != t) {
+        pp = &(*pp)->hnext;
+    }
+    *pp = t->hnext;
+    idx->bytes -= sizeof(purge_tag_t) + strlen(t->name) + 1;
+    Free(t);
+}
+
+/*
+ * purge_index_add - Index a newly added item under uri and the surrogate
+ *     keys in keys (space- or comma-separated, or NULL). links is the
+ *     purge_links_t inside item.
+ */
+void purge_index_add(purge_index_t *idx, purge_links_t *links, void *item, const char *uri, const char *keys) {
+    char buf[MAXLINE], *save, *tok;
+    int n = 0;
+
+    links->rnode = radix_insert(idx, uri);
+    links->rnode->item = item;
+    links->tags = NULL;
+    if (keys == NULL) {
+        return;
+    }
+    snprintf(buf, sizeof(buf), "%s", keys);
+    for (tok = strtok_r(buf, " ,\t", &save); tok != NULL && n < PURGE_MAX_KEYS; tok = strtok_r(NULL, " ,\t", &save)) {
+        purge_tag_t *t = tag_find(idx, tok, 1);
+        if (t->links != NULL && t->links->item == item) {
+            continue; // 같은 키가 두 번 적혀 있다
+        }
+        tag_link_t *l = Malloc(sizeof(tag_link_t));
+        l->tag = t;
+        l->item = item;
+        l->prev = NULL;
+        l->next = t->links;
+        if (l->next != NULL) {
+            l->next->prev = l;
+        }
+        t->links = l;
+        l->enext = links->tags;
+        links->tags = l;
+        idx->bytes += sizeof(tag_link_t);
+        n++;
+    }
+}
+
+/* Drop an item that is leaving from both indexes; nothing happens if it is not indexed */
+void purge_index_remove(purge_index_t *idx, purge_links_t *links) {
+    tag_link_t *l = links->tags;
+
+    while (l != NULL) {
+        tag_link_t *enext = l->enext;
+        if (l->prev == NULL) {
+            l->tag->links = l->next;
+        } else {
+            l->prev->next = l->next;
+        }
+        if (l->next != NULL) {
+            l->next->prev = l->prev;
+        }
+        if (l->tag->links == NULL) {
+            tag_free(idx, l->tag); // 마지막 항목이 빠진 태그
+        }
+        idx->bytes -= sizeof(tag_link_t);
+        Free(l);
+        l = enext;
+    }
+    links->tags = NULL;
+    if (links->rnode != NULL) {
+        radix_remove(idx, links->rnode);
+        links->rnode = NULL;
+    }
+}
+
+static void visit(radix_node_t *n, purge_visit_t fn, void *arg) {
+    if (n->item != NULL) {
+        fn(n->item, arg);
+    }
+    for (radix_node_t *c = n->child; c != NULL; c = c->sibling) {
+        visit(c, fn, arg);
+    }
+}
+
+/*
+ * purge_index_prefix - Call fn on every item whose URI starts with
+ *     prefix. Only the subtree below the prefix is walked. fn must not
+ *     change the index; collect the items and remove them afterwards.
+ */
+void purge_index_prefix(purge_index_t *idx, const char *prefix, purge_visit_t fn, void *arg) {
+    radix_node_t *node = &idx->root;
+    const char *p = prefix;
+
+    while (*p != '\0') {
+        radix_node_t *c = child_for(node, *p);
+        if (c == NULL) {
+            return;
+        }
+        int k = common(c->label, c->len, p);
+        if (p[k] == '\0') {
+            node = c; // prefix가 이 라벨 안에서 끝난다
+            break;
+        }
+        if (k < c->len) {
+            return;
+        }
+        node = c;
+        p += k;
+    }
+    visit(node, fn, arg);
+}
+
+/* Call fn on every item tagged with the surrogate key tag; same rules as purge_index_prefix() */
+void purge_index_tag(purge_index_t *idx, const char *tag, purge_visit_t fn, void *arg) {
+    purge_tag_t *t = tag_find(idx, tag, 0);
+
+    for (tag_link_t *l = t != NULL ? t->links : NULL; l != NULL; l = l->next) {
+        fn(l->item, arg);
+    }
+}
+
+/*
+ * purge_keys - Copy the Surrogate-Key value of the stored response obj
+ *     (length bytes) into keys. Returns 1 if it has one.
+ */
+int purge_keys(const char *obj, int length, char *keys, int size) {
+    char hdr[HTTP_MAX_HEADER + 1];
+    http_response_t resp;
+
+    if (http_parse_response(obj, MIN(length, HTTP_MAX_HEADER), &resp) < 0 || resp.header_len == 0 ||
+        !resp.surrogate_key) {
+        return 0;
+    }
+    memcpy(hdr, obj, resp.header_len);
+    hdr[resp.header_len] = '\0';
+    return http_header_value(hdr, "Surrogate-Key", keys, size);
+}
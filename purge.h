@@ -0,0 +1,67 @@
+/*
+ * purge.h - secondary indexes that let cached objects be invalidated
+ *
+ * Every shard keeps, next to its URI hash index, a radix tree of the URIs
+ * it holds and a table of surrogate keys, the tags an origin lists in a
+ * Surrogate-Key response header; the disk tier keeps one pair for all of
+ * its objects. A purge by prefix walks only the subtree under the prefix
+ * and a purge by tag only the tag's list, so its cost follows the number
+ * of matching objects rather than the cache size. The indexes hold
+ * opaque items that embed a purge_links_t, and are changed and read
+ * under their owner's lock.
+ */
+#ifndef __PURGE_H__
+#define __PURGE_H__
+
+#define PURGE_TAG_BUCKETS 256     /* Surrogate-key buckets of each shard */
+#define PURGE_MAX_KEYS 64         /* Tags kept per object; the rest are ignored */
+
+/* A compressed trie node; the URI of the item at a node is the concatenation of labels above it */
+typedef struct radix_node {
+    char *label;              /* Edge label from the parent, never empty below the root */
+    int len;
+    void *item;               /* Item whose URI ends here, or NULL */
+    struct radix_node *parent;
+    struct radix_node *child;  /* 자식 목록 (첫 글자가 모두 다르다) */
+    struct radix_node *sibling;
+} radix_node_t;
+
+/* One surrogate key and the items tagged with it */
+typedef struct purge_tag {
+    unsigned long hash;
+    struct tag_link *links;
+    struct purge_tag *hnext;
+    char name[];
+} purge_tag_t;
+
+/* Membership of one item in one tag's list */
+typedef struct tag_link {
+    purge_tag_t *tag;
+    void *item;
+    struct tag_link *prev;    /* 같은 태그를 가진 항목들 */
+    struct tag_link *next;
+    struct tag_link *enext;   /* 같은 항목의 다음 태그 */
+} tag_link_t;
+
+/* An item's place in both indexes, embedded in the item */
+typedef struct {
+    radix_node_t *rnode;      /* Node of the radix tree holding the item, NULL if not indexed */
+    tag_link_t *tags;         /* Surrogate keys the origin tagged the item with */
+} purge_links_t;
+
+typedef struct {
+    radix_node_t root;
+    purge_tag_t *tags[PURGE_TAG_BUCKETS];
+    long bytes;               /* Heap memory of both indexes, charged to their owner */
+} purge_index_t;
+
+typedef void (*purge_visit_t)(void *item, void *arg);
+
+void purge_index_init(purge_index_t *idx);
+void purge_index_add(purge_index_t *idx, purge_links_t *links, void *item, const char *uri, const char *keys);
+void purge_index_remove(purge_index_t *idx, purge_links_t *links);
+void purge_index_prefix(purge_index_t *idx, const char *prefix, purge_visit_t fn, void *arg);
+void purge_index_tag(purge_index_t *idx, const char *tag, purge_visit_t fn, void *arg);
+int purge_keys(const char *obj, int length, char *keys, int size);
+
+#endif /* __PURGE_H__ */
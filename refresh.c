@@ -0,0 +1,107 @@
+#include "csapp.h"
+#include "cache.h"
+#include "refresh.h"
+
+static refresh_fetch_t refresh_fetch;
+
+/* Job queue between requesting threads and the workers */
+static refresh_job_t queue[REFRESH_QUEUE_SIZE];
+static int qfront, qrear;
+static sem_t qmutex, qslots, qitems;
+
+static long requests, fills, drops, done;
+
+/* Worker: run queued fetches one at a time */
+static void *refresh_worker(void *vargp) {
+    Pthread_detach(pthread_self());
+    for (;;) {
+        P(&qitems);
+        P(&qmutex);
+        refresh_job_t job = queue[qfront];
+        qfront = (qfront + 1) % REFRESH_QUEUE_SIZE;
+        V(&qmutex);
+        V(&qslots);
+        if (job.stale != NULL) {
+            refresh_fetch(job.stale->uri, job.stale->hash, job.stale);
+            // 갱신이 실패했어도 다음 히트가 다시 시도할 수 있게 표시를 지운다
+            __atomic_store_n(&job.stale->refreshing, 0, __ATOMIC_RELEASE);
+            cache_release(job.stale);
+        } else {
+            refresh_fetch(job.uri, job.hash, NULL);
+            Free(job.uri);
+        }
+        __atomic_fetch_add(&done, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+/* Start the workers; fetch gets the object at uri, revalidating stale if it is set */
+void refresh_init(refresh_fetch_t fetch) {
+    pthread_t tid;
+
+    refresh_fetch = fetch;
+    Sem_init(&qmutex, 0, 1);
+    Sem_init(&qslots, 0, REFRESH_QUEUE_SIZE);
+    Sem_init(&qitems, 0, 0);
+    for (int i = 0; i < REFRESH_WORKERS; i++) {
+        Pthread_create(&tid, NULL, refresh_worker, NULL);
+    }
+}
+
+/* Add a job unless the queue is full; returns 0 if it was dropped */
+static int enqueue(refresh_job_t job) {
+    if (sem_trywait(&qslots) != 0) {
+        __atomic_fetch_add(&drops, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    P(&qmutex);
+    queue[qrear] = job;
+    qrear = (qrear + 1) % REFRESH_QUEUE_SIZE;
+    V(&qmutex);
+    V(&qitems);
+    return 1;
+}
+
+/*
+ * refresh_request - Queue a refresh of a pinned entry the caller won
+ *     with cache_claim_refresh(). Never blocks: when the workers are
+ *     behind, the request is dropped and a later hit claims it again.
+ */
+void refresh_request(cache_entry_t *entry) {
+    refresh_job_t job = { entry, NULL, entry->hash };
+
+    __atomic_fetch_add(&requests, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->refcnt, 1, __ATOMIC_RELAXED); // worker가 끝낼 때까지 항목 유지
+    if (!enqueue(job)) {
+        __atomic_store_n(&entry->refreshing, 0, __ATOMIC_RELEASE);
+        cache_release(entry);
+    }
+}
+
+/*
+ * refresh_fill - Queue a fetch of the whole object at uri so that it can
+ *     be cached. Never blocks; a fill of something that is already cached
+ *     or in flight by then does nothing.
+ */
+void refresh_fill(const char *uri, unsigned long hash) {
+    refresh_job_t job = { NULL, Malloc(strlen(uri) + 1), hash };
+
+    __atomic_fetch_add(&fills, 1, __ATOMIC_RELAXED);
+    strcpy(job.uri, uri);
+    if (!enqueue(job)) {
+        Free(job.uri);
+    }
+}
+
+/* Dump the background fetch counters with sio only */
+void refresh_print_stats(void) {
+    Sio_puts("refresh: requests=");
+    Sio_putl(requests);
+    Sio_puts(" fills=");
+    Sio_putl(fills);
+    Sio_puts(" dropped=");
+    Sio_putl(drops);
+    Sio_puts(" done=");
+    Sio_putl(done);
+    Sio_puts("\n");
+}
@@ -0,0 +1,35 @@
+/*
+ * refresh.h - background fetches: stale-while-revalidate refreshes and
+ * full-object fills
+ *
+ * A hit on an entry that has expired but is still inside its
+ * stale-while-revalidate window is served from the cache at once and
+ * queued here. So is a range request that missed, whose object is then
+ * fetched whole so later ranges can be cut from the cache, once the
+ * origin's answer shows that the object is small enough to be cached. Workers
+ * fetch through a callback supplied by the proxy (conditionally when a
+ * stale entry has validators), so no client thread waits on the origin.
+ */
+#ifndef __REFRESH_H__
+#define __REFRESH_H__
+
+#define REFRESH_WORKERS 2       /* Threads doing background fetches */
+#define REFRESH_QUEUE_SIZE 256  /* Fetches waiting for a worker */
+
+struct cache_entry;
+
+/* A queued fetch: a stale entry to refresh, or only a URI to fill */
+typedef struct {
+    struct cache_entry *stale; /* Pinned; NULL for a fill */
+    char *uri;                 /* Fill only */
+    unsigned long hash;
+} refresh_job_t;
+
+typedef void (*refresh_fetch_t)(const char *uri, unsigned long hash, struct cache_entry *stale);
+
+void refresh_init(refresh_fetch_t fetch);
+void refresh_request(struct cache_entry *entry);
+void refresh_fill(const char *uri, unsigned long hash);
+void refresh_print_stats(void);
+
+#endif /* __REFRESH_H__ */
@@ -0,0 +1,121 @@
+#include "csapp.h"
+#include "sketch.h"
+
+/* Per-row seeds; any odd 64-bit constants will do */
+static const unsigned long seeds[SKETCH_DEPTH] = {
+    0x9E3779B97F4A7C15UL, 0xC2B2AE3D27D4EB4FUL,
+    0x165667B19E3779F9UL, 0xD6E8FEB86659FD93UL,
+};
+
+/* Spread a URI hash into an index for one row */
+static unsigned int row_index(sketch_t *sk, unsigned long hash, int row) {
+    unsigned long h = (hash ^ (hash >> 31)) * seeds[row];
+    return (h >> 32) & (sk->width - 1);
+}
+
+/* Allocate a sketch with width counters per row (rounded up to a power of two) */
+void sketch_init(sketch_t *sk, int width) {
+    int w = 64;
+    while (w < width) {
+        w <<= 1;
+    }
+    sk->width = w;
+    sk->counters = Calloc(SKETCH_DEPTH, w);
+    sk->doorkeeper = Calloc(2 * w / 64, sizeof(unsigned long));
+    sk->samples = 0;
+    sk->aging = 0;
+}
+
+/* Set both doorkeeper bits for hash; returns 1 if they were already set */
+static int doorkeeper_add(sketch_t *sk, unsigned long hash) {
+    int present = 1;
+    unsigned int nbits = 2 * sk->width;
+
+    for (int i = 0; i < 2; i++) {
+        unsigned int bit = (unsigned int)((hash >> (i * 32)) * seeds[i] >> 40) % nbits;
+        unsigned long mask = 1UL << (bit % 64);
+        unsigned long old = __atomic_fetch_or(&sk->doorkeeper[bit / 64], mask, __ATOMIC_RELAXED);
+        if (!(old & mask)) {
+            present = 0;
+        }
+    }
+    return present;
+}
+
+static int doorkeeper_contains(sketch_t *sk, unsigned long hash) {
+    unsigned int nbits = 2 * sk->width;
+
+    for (int i = 0; i < 2; i++) {
+        unsigned int bit = (unsigned int)((hash >> (i * 32)) * seeds[i] >> 40) % nbits;
+        unsigned long word = __atomic_load_n(&sk->doorkeeper[bit / 64], __ATOMIC_RELAXED);
+        if (!(word & (1UL << (bit % 64)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * age - Halve every counter and clear the doorkeeper. Only the thread
+ *     that wins the aging flag does the work; increments racing with it
+ *     may be lost, which the sketch tolerates by design.
+ */
+static void age(sketch_t *sk) {
+    int expected = 0;
+
+    if (!__atomic_compare_exchange_n(&sk->aging, &expected, 1, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    __atomic_store_n(&sk->samples, 0, __ATOMIC_RELAXED);
+    for (long i = 0; i < (long)SKETCH_DEPTH * sk->width; i++) {
+        unsigned char c = __atomic_load_n(&sk->counters[i], __ATOMIC_RELAXED);
+        __atomic_store_n(&sk->counters[i], c >> 1, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < 2 * sk->width / 64; i++) {
+        __atomic_store_n(&sk->doorkeeper[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&sk->aging, 0, __ATOMIC_RELEASE);
+}
+
+/* Record one request for hash; lock-free and safe from any thread */
+void sketch_increment(sketch_t *sk, unsigned long hash) {
+    if (doorkeeper_add(sk, hash)) {
+        /* Conservative update: only bump the counters holding the minimum */
+        unsigned char *cells[SKETCH_DEPTH];
+        int min = SKETCH_MAX_COUNT;
+
+        for (int i = 0; i < SKETCH_DEPTH; i++) {
+            cells[i] = &sk->counters[(long)i * sk->width + row_index(sk, hash, i)];
+            int c = __atomic_load_n(cells[i], __ATOMIC_RELAXED);
+            if (c < min) {
+                min = c;
+            }
+        }
+        if (min < SKETCH_MAX_COUNT) {
+            for (int i = 0; i < SKETCH_DEPTH; i++) {
+                if (__atomic_load_n(cells[i], __ATOMIC_RELAXED) == min) {
+                    __atomic_store_n(cells[i], min + 1, __ATOMIC_RELAXED);
+                }
+            }
+        }
+    }
+
+    if (__atomic_add_fetch(&sk->samples, 1, __ATOMIC_RELAXED) >= (long)SKETCH_SAMPLE_FACTOR * sk->width) {
+        age(sk);
+    }
+}
+
+/* Estimated recent request count for hash */
+int sketch_frequency(sketch_t *sk, unsigned long hash) {
+    int min = SKETCH_MAX_COUNT;
+
+    for (int i = 0; i < SKETCH_DEPTH; i++) {
+        unsigned char c = __atomic_load_n(&sk->counters[(long)i * sk->width + row_index(sk, hash, i)],
+                                          __ATOMIC_RELAXED);
+        if (c < min) {
+            min = c;
+        }
+    }
+    return min + doorkeeper_contains(sk, hash);
+}
@@ -0,0 +1,29 @@
+/*
+ * sketch.h - TinyLFU frequency sketch (count-min + doorkeeper)
+ *
+ * Estimates how often a URI hash was requested recently. The first
+ * sighting of a key only sets its doorkeeper bit, so one-hit wonders
+ * never reach the counters. After SKETCH_SAMPLE_FACTOR * width
+ * increments every counter is halved and the doorkeeper is cleared,
+ * so old popularity fades out.
+ */
+#ifndef __SKETCH_H__
+#define __SKETCH_H__
+
+#define SKETCH_DEPTH 4            /* Independent count-min rows */
+#define SKETCH_MAX_COUNT 15       /* Counters saturate at 4 bits */
+#define SKETCH_SAMPLE_FACTOR 10   /* Aging period, in multiples of width */
+
+typedef struct {
+    unsigned char *counters;      /* SKETCH_DEPTH rows of width counters */
+    unsigned long *doorkeeper;    /* Bloom filter bits, 2 * width of them */
+    int width;                    /* Counters per row (power of two) */
+    long samples;                 /* Increments since the last aging */
+    int aging;                    /* Set while one thread halves the counters */
+} sketch_t;
+
+void sketch_init(sketch_t *sk, int width);
+void sketch_increment(sketch_t *sk, unsigned long hash);
+int sketch_frequency(sketch_t *sk, unsigned long hash);
+
+#endif /* __SKETCH_H__ */
@@ -0,0 +1,411 @@
+#include "csapp.h"
+#include "slab.h"
+
+/* A free item is linked through its first word */
+typedef struct slab_item {
+    struct slab_item *next;
+} slab_item_t;
+
+/* Header at the start of every page */
+typedef struct slab_page {
+    int cls;                       /* Size class that owns the page */
+    int nused;                     /* Items currently handed out */
+    int ncarved;                   /* Items carved from the page so far */
+    int on_partial;                /* Linked into the class partial list? */
+    int draining;                  /* 1 + its slot in draining[] while slab_automove() empties it, else 0 */
+    slab_item_t *free;             /* Freed items of this page */
+    struct slab_page *prev, *next; /* Partial list, or the shared pool */
+} slab_page_t;
+
+#define SLAB_HDR_SIZE ((sizeof(slab_page_t) + 63) & ~63UL)
+
+typedef struct {
+    size_t size;                   /* Item size of this class */
+    int perpage;                   /* Items that fit on one page */
+    slab_page_t *partial;          /* Pages with at least one free item */
+    slab_page_t *partial_tail;
+    long npages;                   /* Pages owned by this class */
+    long nused;                    /* Items handed out over all pages */
+    long grown;                    /* Pages that had to come from the system */
+    long grown_seen;               /* grown at the last slab_automove() */
+    sem_t mutex;                   /* Protects everything above */
+} slab_class_t;
+
+static slab_class_t classes[SLAB_MAX_CLASSES];
+static int nclasses;
+
+static slab_page_t *free_pages;    /* Empty pages shared by all classes */
+static int nfree_pages;
+static long total_pages;           /* Pages currently allocated from the system */
+static sem_t pool_mutex;           /* Protects free_pages, draining[] and the counters */
+
+static slab_page_t *draining[SLAB_MAX_DRAINING]; /* Pages being moved to another class */
+static int drain_cls[SLAB_MAX_DRAINING];         /* Their classes */
+static int drain_ticks[SLAB_MAX_DRAINING];       /* slab_automove() calls since each started */
+static long moves;                 /* Pages emptied and handed back to the pool */
+static long aborted_moves;         /* Pages that stayed busy for SLAB_DRAIN_TICKS */
+
+/* Build size classes from SLAB_MIN_ITEM up to max_item */
+void slab_init(size_t max_item) {
+    size_t size = SLAB_MIN_ITEM;
+
+    if (max_item > SLAB_PAGE_SIZE - SLAB_HDR_SIZE) {
+        app_error("slab_init: item larger than a page");
+    }
+    nclasses = 0;
+    while (nclasses < SLAB_MAX_CLASSES) {
+        if (size > max_item || nclasses == SLAB_MAX_CLASSES - 1) {
+            size = max_item;
+        }
+        size = (size + 7) & ~7UL; /* Keep items pointer aligned */
+        classes[nclasses].size = size;
+        classes[nclasses].perpage = (SLAB_PAGE_SIZE - SLAB_HDR_SIZE) / size;
+        classes[nclasses].partial = classes[nclasses].partial_tail = NULL;
+        classes[nclasses].npages = 0;
+        classes[nclasses].nused = 0;
+        classes[nclasses].grown = classes[nclasses].grown_seen = 0;
+        Sem_init(&classes[nclasses].mutex, 0, 1);
+        nclasses++;
+        if (size >= max_item) {
+            break;
+        }
+        size = size * SLAB_GROWTH_FACTOR;
+    }
+
+    free_pages = NULL;
+    nfree_pages = 0;
+    total_pages = 0;
+    memset(draining, 0, sizeof(draining));
+    moves = aborted_moves = 0;
+    Sem_init(&pool_mutex, 0, 1);
+}
+
+/* Smallest class whose items hold size bytes */
+static int class_for(size_t size) {
+    int lo = 0, hi = nclasses - 1;
+
+    if (size > classes[hi].size) {
+        app_error("slab_alloc: item too large");
+    }
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (classes[mid].size >= size) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/* Take an empty page from the shared pool, or from the system (*fresh is then set) */
+static slab_page_t *page_get(int *fresh) {
+    slab_page_t *page;
+
+    P(&pool_mutex);
+    page = free_pages;
+    if (page != NULL) {
+        free_pages = page->next;
+        nfree_pages--;
+    } else {
+        total_pages++;
+    }
+    V(&pool_mutex);
+    *fresh = page == NULL;
+
+    if (page == NULL) {
+        void *mem;
+        int rc = posix_memalign(&mem, SLAB_PAGE_SIZE, SLAB_PAGE_SIZE);
+        if (rc != 0) {
+            posix_error(rc, "slab page allocation failed");
+        }
+        page = mem;
+    }
+    return page;
+}
+
+/* Give an empty page back to the shared pool so any class can reuse it */
+static void page_put(slab_page_t *page) {
+    P(&pool_mutex);
+    if (nfree_pages < SLAB_MAX_FREE_PAGES) {
+        page->next = free_pages;
+        free_pages = page;
+        nfree_pages++;
+        page = NULL;
+    } else {
+        total_pages--;
+    }
+    V(&pool_mutex);
+
+    if (page != NULL) {
+        free(page);
+    }
+}
+
+/* Partial-list helpers; caller holds the class mutex */
+static void partial_append(slab_class_t *c, slab_page_t *page) {
+    page->next = NULL;
+    page->prev = c->partial_tail;
+    if (c->partial_tail != NULL) {
+        c->partial_tail->next = page;
+    } else {
+        c->partial = page;
+    }
+    c->partial_tail = page;
+    page->on_partial = 1;
+}
+
+static void partial_remove(slab_class_t *c, slab_page_t *page) {
+    if (page->prev != NULL) {
+        page->prev->next = page->next;
+    } else {
+        c->partial = page->next;
+    }
+    if (page->next != NULL) {
+        page->next->prev = page->prev;
+    } else {
+        c->partial_tail = page->prev;
+    }
+    page->on_partial = 0;
+}
+
+/* Allocate an item of at least size bytes from the matching class */
+void *slab_alloc(size_t size) {
+    int cls = class_for(size);
+    slab_class_t *c = &classes[cls];
+    slab_page_t *page;
+    void *item;
+    int fresh;
+
+    P(&c->mutex);
+    page = c->partial;
+    if (page == NULL) {
+        V(&c->mutex);
+        page = page_get(&fresh); // 페이지 풀 잠금은 클래스 잠금 밖에서 잡는다
+        page->cls = cls;
+        page->nused = page->ncarved = 0;
+        page->draining = 0;
+        page->free = NULL;
+        P(&c->mutex);
+        c->npages++;
+        c->grown += fresh; // 풀이 비어 시스템에서 받아야 했다: slab_automove()가 본다
+        partial_append(c, page);
+    }
+
+    if (page->free != NULL) {
+        item = page->free;
+        page->free = page->free->next;
+    } else {
+        item = (char *)page + SLAB_HDR_SIZE + (size_t)page->ncarved * c->size;
+        page->ncarved++;
+    }
+    c->nused++;
+    if (++page->nused == c->perpage) {
+        partial_remove(c, page); // 가득 찬 페이지는 partial 목록에서 뺀다
+    }
+    V(&c->mutex);
+    return item;
+}
+
+/* Page header of any item handed out by slab_alloc() */
+static slab_page_t *page_of(void *ptr) {
+    return (slab_page_t *)((unsigned long)ptr & ~((unsigned long)SLAB_PAGE_SIZE - 1));
+}
+
+/* Return an item to its page; a page that becomes empty leaves the class */
+void slab_free(void *ptr) {
+    slab_page_t *page = page_of(ptr);
+    slab_class_t *c = &classes[page->cls];
+    slab_item_t *item = ptr;
+
+    P(&c->mutex);
+    item->next = page->free;
+    page->free = item;
+    page->nused--;
+    c->nused--;
+    if (page->nused == 0) {
+        if (page->on_partial) {
+            partial_remove(c, page);
+        }
+        if (page->draining) {
+            P(&pool_mutex); // 클래스 잠금 -> 풀 잠금 순서만 쓴다
+            draining[page->draining - 1] = NULL;
+            moves++;
+            V(&pool_mutex);
+        }
+        c->npages--;
+        V(&c->mutex);
+        page_put(page);
+        return;
+    }
+    if (!page->on_partial && !page->draining) { // 비우는 중인 페이지에는 다시 할당하지 않는다
+        partial_append(c, page);
+    }
+    V(&c->mutex);
+}
+
+/* Usable size of an item (its class size) */
+size_t slab_item_size(void *ptr) {
+    return classes[page_of(ptr)->cls].size;
+}
+
+/* Give the pooled empty pages back to the system; the memory accountant calls this over budget */
+void slab_trim(void) {
+    slab_page_t *page;
+
+    P(&pool_mutex);
+    page = free_pages;
+    free_pages = NULL;
+    total_pages -= nfree_pages;
+    nfree_pages = 0;
+    V(&pool_mutex);
+
+    while (page != NULL) {
+        slab_page_t *next = page->next;
+        free(page);
+        page = next;
+    }
+}
+
+/* Number of pages currently taken from the system */
+long slab_pages(void) {
+    return __atomic_load_n(&total_pages, __ATOMIC_RELAXED);
+}
+
+/*
+ * drain_check - Give up on the page in draining[slot] once it has stayed
+ *     busy for SLAB_DRAIN_TICKS calls; items pinned by in-flight fetches
+ *     can hold a page indefinitely. Returns the page if it is still
+ *     draining.
+ */
+static slab_page_t *drain_check(int slot) {
+    slab_page_t *page;
+    slab_class_t *c;
+
+    P(&pool_mutex);
+    page = draining[slot];
+    c = &classes[drain_cls[slot]];
+    V(&pool_mutex);
+    if (page == NULL) {
+        return NULL;
+    }
+
+    P(&c->mutex);
+    P(&pool_mutex);
+    if (draining[slot] != page) { // 그 사이 비워져 풀로 돌아갔다
+        page = NULL;
+    } else if (++drain_ticks[slot] > SLAB_DRAIN_TICKS) {
+        draining[slot] = NULL;
+        aborted_moves++;
+        page->draining = 0;
+        partial_append(c, page); // 다시 원래 클래스의 페이지로 쓴다
+        page = NULL;
+    }
+    V(&pool_mutex);
+    V(&c->mutex);
+    return page;
+}
+
+/* Stop allocating from donor's least-used partial page and give it a free slot in draining[] */
+static slab_page_t *drain_start(int donor) {
+    slab_class_t *c = &classes[donor];
+    slab_page_t *page = NULL;
+    int slot = -1;
+
+    P(&c->mutex);
+    for (slab_page_t *p = c->partial; p != NULL; p = p->next) {
+        if (page == NULL || p->nused < page->nused) {
+            page = p;
+        }
+    }
+    if (page != NULL) {
+        P(&pool_mutex);
+        for (int i = 0; i < SLAB_MAX_DRAINING && slot < 0; i++) {
+            if (draining[i] == NULL) {
+                slot = i;
+            }
+        }
+        if (slot >= 0) {
+            draining[slot] = page;
+            drain_cls[slot] = donor;
+            drain_ticks[slot] = 0;
+            page->draining = slot + 1;
+            partial_remove(c, page);
+        } else {
+            page = NULL;
+        }
+        V(&pool_mutex);
+    }
+    V(&c->mutex);
+    return page;
+}
+
+/*
+ * slab_automove - Move pages between classes when the size mix shifts;
+ *     called about once a second. A class that had to take pages from the
+ *     system since the last call is starving, while another class may sit
+ *     on sparsely used pages that never become completely empty. For each
+ *     page the starving class took, up to SLAB_MAX_DRAINING at a time, the
+ *     class with the most free items (at least SLAB_AUTOMOVE_FREE pages'
+ *     worth) stops allocating from its least-used partial page and evict
+ *     is called on the page's address range so the owners drop the items
+ *     on it. The emptied page goes back to the shared pool, where the
+ *     starving class picks it up, as with memcached's slab_automove.
+ */
+void slab_automove(void (*evict)(void *lo, void *hi)) {
+    long grown[SLAB_MAX_CLASSES], free_items[SLAB_MAX_CLASSES];
+    int starving = -1, busy = 0;
+    slab_page_t *page;
+
+    for (int i = 0; i < SLAB_MAX_DRAINING; i++) {
+        if ((page = drain_check(i)) != NULL) {
+            evict(page, (char *)page + SLAB_PAGE_SIZE); // 아직 남은 항목을 다시 내보낸다
+            busy++;
+        }
+    }
+
+    for (int i = 0; i < nclasses; i++) {
+        slab_class_t *c = &classes[i];
+
+        P(&c->mutex);
+        grown[i] = c->grown - c->grown_seen;
+        c->grown_seen = c->grown;
+        free_items[i] = c->npages * c->perpage - c->nused;
+        V(&c->mutex);
+        if (grown[i] > 0 && free_items[i] < SLAB_AUTOMOVE_FREE * (long)c->perpage &&
+            (starving < 0 || grown[i] > grown[starving])) {
+            starving = i; // 빈 자리가 많은 클래스는 모자란 게 아니다
+        }
+    }
+    if (starving < 0) {
+        return;
+    }
+
+    for (long n = grown[starving]; n > 0 && busy < SLAB_MAX_DRAINING; n--, busy++) {
+        int donor = -1;
+        for (int i = 0; i < nclasses; i++) {
+            if (i != starving && free_items[i] >= SLAB_AUTOMOVE_FREE * (long)classes[i].perpage &&
+                (donor < 0 || free_items[i] > free_items[donor])) {
+                donor = i;
+            }
+        }
+        if (donor < 0 || (page = drain_start(donor)) == NULL) {
+            return;
+        }
+        free_items[donor] -= classes[donor].perpage; // 추정치: 다음 donor 선택에만 쓴다
+        evict(page, (char *)page + SLAB_PAGE_SIZE);
+    }
+}
+
+/* Dump the page counters with sio only, like cache_print_stats() */
+void slab_print_stats(void) {
+    Sio_puts("slab: pages=");
+    Sio_putl(total_pages);
+    Sio_puts(" pooled=");
+    Sio_putl(nfree_pages);
+    Sio_puts(" moves=");
+    Sio_putl(moves);
+    Sio_puts(" aborted_moves=");
+    Sio_putl(aborted_moves);
+    Sio_puts("\n");
+}
@@ -0,0 +1,33 @@
+/*
+ * slab.h - size-class allocator for cache entries and body chunks
+ *
+ * Memory is carved out of 1 MB pages. Each page belongs to one size
+ * class at a time; once every item on a page is free again the page goes
+ * back to a shared pool and can be reused by any other class. Pages that
+ * stay sparsely used never empty on their own, so slab_automove() drains
+ * some when another class is starving and the object-size mix has moved.
+ */
+#ifndef __SLAB_H__
+#define __SLAB_H__
+
+#include <stddef.h>
+
+#define SLAB_PAGE_SIZE (1024 * 1024) /* Pages are also aligned to this size */
+#define SLAB_MIN_ITEM 64             /* Smallest size class */
+#define SLAB_GROWTH_FACTOR 1.25      /* Ratio between neighbouring classes */
+#define SLAB_MAX_CLASSES 64
+#define SLAB_MAX_FREE_PAGES 8        /* Empty pages kept in the shared pool */
+#define SLAB_AUTOMOVE_FREE 2         /* Free items, in pages, that make a class a donor */
+#define SLAB_MAX_DRAINING 8          /* Pages slab_automove() empties at once */
+#define SLAB_DRAIN_TICKS 5           /* slab_automove() calls before a busy page is kept */
+
+void slab_init(size_t max_item);
+void *slab_alloc(size_t size);
+void slab_free(void *ptr);
+size_t slab_item_size(void *ptr);
+long slab_pages(void);
+void slab_trim(void);
+void slab_automove(void (*evict)(void *lo, void *hi));
+void slab_print_stats(void);
+
+#endif /* __SLAB_H__ */
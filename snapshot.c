@@ -0,0 +1,186 @@
+#include "csapp.h"
+#include "cache.h"
+#include "disk.h"
+#include "snapshot.h"
+
+static const char *snap_path;
+static int snap_interval;           /* Seconds between checkpoints, 0 = on request only */
+static sem_t snap_wake;             /* Posted by snapshot_request(), also from signal handlers */
+static volatile sig_atomic_t snap_exit;
+
+static char *map;                   /* Restored snapshot, shared by its entries */
+static size_t map_len;
+static long map_refs;               /* Entries still pointing into map */
+
+/*
+ * snapshot_load - Publish every object in the snapshot at path. Bodies
+ *     stay in the read-only mapping and are not touched here. Returns
+ *     the number of objects restored; a missing or foreign file restores
+ *     nothing, and a truncated one restores what comes before the damage.
+ */
+long snapshot_load(const char *path) {
+    struct stat st;
+    char uri[MAXLINE];
+    long restored = 0, now = time(NULL);
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        return 0;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(snapshot_header_t)) {
+        close(fd);
+        return 0;
+    }
+    map_len = st.st_size;
+    map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        map = NULL;
+        return 0;
+    }
+
+    snapshot_header_t *hdr = (snapshot_header_t *)map;
+    char *p = map + sizeof(*hdr), *end = map + map_len;
+    map_refs = 1; // 로딩이 끝날 때까지 매핑 유지
+    if (hdr->magic == SNAPSHOT_MAGIC && hdr->version == SNAPSHOT_VERSION) {
+        for (long i = 0; i < hdr->count && end - p >= (long)sizeof(disk_record_t); i++) {
+            disk_record_t rec;
+            memcpy(&rec, p, sizeof(rec));
+            if (rec.magic != DISK_RECORD_MAGIC || rec.urilen <= 0 || rec.urilen >= MAXLINE ||
+                rec.length <= 0 || rec.length > MAX_OBJECT_SIZE ||
+                end - p < (long)sizeof(rec) + rec.urilen + rec.length) {
+                fprintf(stderr, "snapshot: damaged record %ld, stopping\n", i);
+                break;
+            }
+            p += sizeof(rec);
+            memcpy(uri, p, rec.urilen);
+            uri[rec.urilen] = '\0';
+            p += rec.urilen;
+            if (rec.expires == 0 || rec.expires > now) { // 꺼져 있던 동안 만료된 객체는 건너뛴다
+                __atomic_fetch_add(&map_refs, 1, __ATOMIC_RELAXED);
+                restored += cache_insert_mapped(uri, cache_hash(uri), p, rec.length, rec.expires);
+            }
+            p += rec.length;
+        }
+    }
+    snapshot_unref();
+    return restored;
+}
+
+/* Drop one reference to the restored mapping; the last one unmaps it */
+void snapshot_unref(void) {
+    if (__atomic_sub_fetch(&map_refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        munmap(map, map_len);
+        map = NULL;
+    }
+}
+
+/* State of one snapshot_write() passed through cache_walk() */
+typedef struct {
+    int fd;                   // 쓰기 실패 후에는 -1
+    long count;               // 지금까지 쓴 레코드 수
+} snap_writer_t;
+
+/* cache_walk() callback: append one entry as a record */
+static void write_entry(cache_entry_t *e, void *arg) {
+    snap_writer_t *w = arg;
+    disk_record_t rec = { DISK_RECORD_MAGIC, strlen(e->uri), e->content_length, e->hash, e->expires };
+
+    if (w->fd < 0) {
+        return; // 앞선 쓰기가 실패했다
+    }
+    if (rio_writen(w->fd, &rec, sizeof(rec)) < 0 || rio_writen(w->fd, e->uri, rec.urilen) < 0) {
+        w->fd = -1;
+        return;
+    }
+    if (e->mapped != NULL) {
+        if (rio_writen(w->fd, (void *)e->mapped, e->content_length) < 0) {
+            w->fd = -1;
+            return;
+        }
+    }
+    for (buf_chunk_t *c = e->chunks; c != NULL; c = c->next) {
+        if (rio_writen(w->fd, c->data, c->len) < 0) {
+            w->fd = -1;
+            return;
+        }
+    }
+    w->count++;
+}
+
+/*
+ * snapshot_write - Checkpoint the whole cache to snap_path. Entries
+ *     evicted while the snapshot is written may or may not be in it;
+ *     either way every record is complete.
+ */
+static void snapshot_write(void) {
+    char tmp[MAXLINE];
+    snapshot_header_t hdr = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, 0 };
+    snap_writer_t w;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", snap_path);
+    if ((w.fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0) {
+        fprintf(stderr, "snapshot: %s: %s\n", tmp, strerror(errno));
+        return;
+    }
+    int fd = w.fd;
+    w.count = 0;
+    if (rio_writen(fd, &hdr, sizeof(hdr)) < 0) {
+        w.fd = -1;
+    }
+    cache_walk(write_entry, &w);
+    hdr.count = w.count; // 헤더는 다 쓴 뒤에 실제 레코드 수로 채운다
+    if (w.fd < 0 || pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || fsync(fd) < 0) {
+        fprintf(stderr, "snapshot: failed to write %s\n", tmp);
+        close(fd);
+        unlink(tmp);
+        return;
+    }
+    close(fd);
+    if (rename(tmp, snap_path) < 0) {
+        fprintf(stderr, "snapshot: rename to %s: %s\n", snap_path, strerror(errno));
+        unlink(tmp);
+        return;
+    }
+    printf("Snapshot of %ld objects written to %s\n", hdr.count, snap_path);
+}
+
+/* Checkpoint thread: sleeps until the interval passes or a request comes in */
+static void *snapshot_thread(void *vargp) {
+    Pthread_detach(pthread_self());
+    for (;;) {
+        if (snap_interval > 0) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += snap_interval;
+            while (sem_timedwait(&snap_wake, &ts) < 0 && errno == EINTR)
+                ;
+        } else {
+            while (sem_wait(&snap_wake) < 0 && errno == EINTR)
+                ;
+        }
+        snapshot_write();
+        if (snap_exit) {
+            exit(0);
+        }
+    }
+    return NULL;
+}
+
+/* Start checkpointing to path every interval seconds (0 = only on request) */
+void snapshot_init(const char *path, int interval) {
+    pthread_t tid;
+
+    snap_path = path;
+    snap_interval = interval;
+    Sem_init(&snap_wake, 0, 0);
+    Pthread_create(&tid, NULL, snapshot_thread, NULL);
+}
+
+/* Ask for a checkpoint now, then exit if exit_after is set. Async-signal-safe. */
+void snapshot_request(int exit_after) {
+    if (exit_after) {
+        snap_exit = 1;
+    }
+    sem_post(&snap_wake);
+}
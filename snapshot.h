@@ -0,0 +1,31 @@
+/*
+ * snapshot.h - cache checkpoints and warm restart
+ *
+ * A background thread writes every cached object to a snapshot file,
+ * periodically and/or when a signal handler asks for it. The file is
+ * written next to the old one and renamed into place, so a crash never
+ * leaves a torn snapshot behind. On startup the snapshot is mmap()ed and
+ * its objects are published straight from the mapping; their pages are
+ * faulted in only when they are first served.
+ *
+ * Layout: a snapshot_header_t followed by count records in the disk
+ * tier's format (disk_record_t, URI, object bytes).
+ */
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#define SNAPSHOT_MAGIC 0x50585350U   /* "PXSP" */
+#define SNAPSHOT_VERSION 2
+
+typedef struct {
+    unsigned int magic;
+    int version;
+    long count;               /* Records that follow */
+} snapshot_header_t;
+
+long snapshot_load(const char *path);
+void snapshot_init(const char *path, int interval);
+void snapshot_request(int exit_after);
+void snapshot_unref(void);
+
+#endif /* __SNAPSHOT_H__ */
@@ -15,9 +15,9 @@
 sbuf_t sbuf;
 
 void doit(int fd);
-void read_requesthdrs(rio_t *rp);
+void read_requesthdrs(rio_t *rp, char *inm, char *ims);
 int parse_uri(char *uri, char *filename, char *cgiargs);
-void serve_static(int fd, char *filename, int filesize, int no_body);
+void serve_static(int fd, char *filename, struct stat *sbuf, char *inm, char *ims, int no_body);
 void get_filetype(char *filename, char *filetype);
 void serve_dynamic(int fd, char *filename, char *cgiargs, int no_body);
 void clienterror(int fd, char *cause, char *errnum, char *shortmsg, char *longmsg);
@@ -90,6 +90,8 @@ void doit(int fd) {
   char version[MAXLINE];
   char filename[MAXLINE];
   char cgiargs[MAXLINE];
+  char inm[MAXLINE];  /* If-None-Match */
+  char ims[MAXLINE];  /* If-Modified-Since */
   rio_t rio;
   int no_body = 0;
 
@@ -107,7 +109,7 @@ void doit(int fd) {
     clienterror(fd, method, "501", "Not Implemented", "Tiny does not implement this method");
     return;
   }
-  read_requesthdrs(&rio);
+  read_requesthdrs(&rio, inm, ims);
 
   /* Parse URI from GET request */
   is_static = parse_uri(uri, filename, cgiargs);
@@ -121,7 +123,7 @@ void doit(int fd) {
       clienterror(fd, filename, "403", "Forbidden", "Tiny couldn't read the file");
       return;
     }
-    serve_static(fd, filename, sbuf.st_size, no_body);
+    serve_static(fd, filename, &sbuf, inm, ims, no_body);
   } else { /* Serve dynamic content */
     if(!(S_ISREG(sbuf.st_mode)) || !(S_IXUSR & sbuf.st_mode)) {
       clienterror(fd, filename, "403", "Forbidden", "Tiny couldn't run the CGI program");
@@ -150,14 +152,24 @@ void clienterror(int fd, char* cause, char* errnum, char* shortmsg, char* longms
   Rio_writen(fd, body, strlen(body));
 }
 
-void read_requesthdrs(rio_t* rp) {
+/*
+ * read_requesthdrs - Skip the request headers, keeping the validators of
+ *   a conditional GET in inm and ims (empty strings if absent)
+ */
+void read_requesthdrs(rio_t* rp, char* inm, char* ims) {
   char buf[MAXLINE];
 
+  inm[0] = ims[0] = '\0';
   while(Rio_readlineb(rp, buf, MAXLINE) > 0) {
     if (strcmp(buf, "\r\n") == 0) {
       break;
     }
     printf("%s", buf);
+    if (strncasecmp(buf, "If-None-Match:", 14) == 0) {
+      sscanf(buf + 14, " %[^\r\n]", inm);
+    } else if (strncasecmp(buf, "If-Modified-Since:", 18) == 0) {
+      sscanf(buf + 18, " %[^\r\n]", ims);
+    }
   }
 }
 
@@ -186,11 +198,34 @@ int parse_uri(char* uri, char* filename, char* cgiargs) {
   }
 }
 
-void serve_static(int fd, char* filename, int filesize, int no_body) {
+void serve_static(int fd, char* filename, struct stat* sbuf, char* inm, char* ims, int no_body) {
   int srcfd;
   char* srcp;
   char filetype[MAXLINE];
   char buf[MAXBUF];
+  char etag[64];
+  char lastmod[64];
+  int filesize = sbuf->st_size;
+
+  /* Validators: the ETag changes with size or mtime, like most servers */
+  snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (long)sbuf->st_size, (long)sbuf->st_mtime);
+  strftime(lastmod, sizeof(lastmod), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&sbuf->st_mtime));
+
+  /* Conditional GET: If-None-Match wins; If-Modified-Since must match exactly */
+  if ((inm[0] && (strstr(inm, etag) || strcmp(inm, "*") == 0)) ||
+      (!inm[0] && ims[0] && strcmp(ims, lastmod) == 0)) {
+    snprintf(buf, MAXBUF,
+             "HTTP/1.0 304 Not Modified\r\n"
+             "Server: Tiny Web Server\r\n"
+             "Connection: close\r\n"
+             "ETag: %s\r\n"
+             "Last-Modified: %s\r\n\r\n",
+             etag, lastmod);
+    Rio_writen(fd, buf, strlen(buf));
+    printf("Response headers:\n");
+    printf("%s", buf);
+    return;
+  }
 
   /* Send response headers to client */
   get_filetype(filename, filetype);
@@ -200,8 +235,10 @@ void serve_static(int fd, char* filename, int filesize, int no_body) {
                        "Server: Tiny Web Server\r\n"
                        "Connection: close\r\n"
                        "Content-length: %d\r\n"
-                       "Content-type: %s\r\n\r\n",
-                       filesize, filetype);
+                       "Content-type: %s\r\n"
+                       "ETag: %s\r\n"
+                       "Last-Modified: %s\r\n\r\n",
+                       filesize, filetype, etag, lastmod);
 
   if (len >= MAXBUF) {
     fprintf(stderr, "Error: Response headers truncated.\n");
@@ -0,0 +1,147 @@
+#include "csapp.h"
+#include "vary.h"
+#include "mem.h"
+
+/* The Vary list of one URI */
+typedef struct vary_node {
+    unsigned long hash;
+    char *uri;
+    char names[HTTP_MAX_VARY];
+    struct vary_node *hnext;
+} vary_node_t;
+
+/* The URIs whose hash falls in one stripe, chained in a bucket array that grows */
+typedef struct {
+    sem_t lock;
+    vary_node_t **buckets;
+    int nbuckets;             /* Power of two */
+    int count;
+} vary_stripe_t;
+
+static vary_stripe_t stripes[VARY_LOCKS];
+static int recorded;          /* URIs in the table; lookups skip it while it is 0 */
+static long lookups, variants, records;
+
+void vary_init(void) {
+    for (int i = 0; i < VARY_LOCKS; i++) {
+        Sem_init(&stripes[i].lock, 0, 1);
+        stripes[i].buckets = Calloc(VARY_MIN_BUCKETS, sizeof(vary_node_t *));
+        stripes[i].nbuckets = VARY_MIN_BUCKETS;
+        stripes[i].count = 0;
+    }
+    mem_overhead_charge(VARY_LOCKS * VARY_MIN_BUCKETS * sizeof(vary_node_t *));
+}
+
+/* The bucket of hash in its stripe; the low bits already chose the stripe */
+static vary_node_t **vary_bucket(vary_stripe_t *st, unsigned long hash) {
+    return &st->buckets[(hash / VARY_LOCKS) & (st->nbuckets - 1)];
+}
+
+/* Find the link that points at uri's node, or at the NULL ending its bucket */
+static vary_node_t **vary_find(vary_stripe_t *st, const char *uri, unsigned long hash) {
+    vary_node_t **pp = vary_bucket(st, hash);
+
+    while (*pp != NULL && ((*pp)->hash != hash || strcmp((*pp)->uri, uri) != 0)) {
+        pp = &(*pp)->hnext;
+    }
+    return pp;
+}
+
+/* Double a stripe's buckets once it holds more URIs than buckets; caller holds its lock */
+static void vary_grow(vary_stripe_t *st) {
+    vary_node_t **old = st->buckets;
+    int n = st->nbuckets;
+
+    st->buckets = Calloc(n * 2, sizeof(vary_node_t *));
+    st->nbuckets = n * 2;
+    for (int i = 0; i < n; i++) {
+        while (old[i] != NULL) {
+            vary_node_t *v = old[i];
+            vary_node_t **b = vary_bucket(st, v->hash);
+            old[i] = v->hnext;
+            v->hnext = *b;
+            *b = v;
+        }
+    }
+    Free(old);
+    mem_overhead_charge(n * sizeof(vary_node_t *));
+}
+
+/*
+ * vary_lookup - Copy the Vary list recorded for uri into names (at least
+ *     HTTP_MAX_VARY bytes). Returns 1 if there is one, 0 if its responses
+ *     are not known to vary.
+ */
+int vary_lookup(const char *uri, unsigned long hash, char *names) {
+    vary_stripe_t *st = &stripes[hash % VARY_LOCKS];
+    vary_node_t *v;
+
+    if (__atomic_load_n(&recorded, __ATOMIC_ACQUIRE) == 0) {
+        return 0; // 아직 Vary 응답을 본 적이 없다
+    }
+    __atomic_fetch_add(&lookups, 1, __ATOMIC_RELAXED);
+    P(&st->lock);
+    if ((v = *vary_find(st, uri, hash)) != NULL) {
+        strcpy(names, v->names);
+    }
+    V(&st->lock);
+    if (v != NULL) {
+        __atomic_fetch_add(&variants, 1, __ATOMIC_RELAXED);
+    }
+    return v != NULL;
+}
+
+/*
+ * vary_record - Remember that the responses for uri vary by the headers
+ *     in names, as normalised by http_parse_response(). An empty list
+ *     forgets uri.
+ */
+void vary_record(const char *uri, unsigned long hash, const char *names) {
+    vary_stripe_t *st = &stripes[hash % VARY_LOCKS];
+    vary_node_t *old = NULL;
+
+    P(&st->lock);
+    vary_node_t **pp = vary_find(st, uri, hash);
+    if (names[0] == '\0') {
+        if ((old = *pp) != NULL) {
+            *pp = old->hnext;
+            st->count--;
+            __atomic_fetch_sub(&recorded, 1, __ATOMIC_RELEASE);
+        }
+    } else {
+        if (*pp == NULL) {
+            vary_node_t *v = Malloc(sizeof(vary_node_t));
+            v->hash = hash;
+            v->uri = Malloc(strlen(uri) + 1);
+            strcpy(v->uri, uri);
+            v->hnext = NULL;
+            *pp = v;
+            mem_overhead_charge(sizeof(vary_node_t) + strlen(uri) + 1);
+            st->count++;
+            __atomic_fetch_add(&recorded, 1, __ATOMIC_RELEASE);
+        }
+        snprintf((*pp)->names, sizeof((*pp)->names), "%s", names);
+        __atomic_fetch_add(&records, 1, __ATOMIC_RELAXED);
+        if (st->count > st->nbuckets) {
+            vary_grow(st); // 부하율이 1을 넘으면 버킷 수를 두 배로
+        }
+    }
+    V(&st->lock);
+    if (old != NULL) {
+        mem_overhead_charge(-(long)(sizeof(vary_node_t) + strlen(old->uri) + 1));
+        Free(old->uri);
+        Free(old);
+    }
+}
+
+void vary_print_stats(void) {
+    Sio_puts("vary: uris=");
+    Sio_putl(__atomic_load_n(&recorded, __ATOMIC_RELAXED));
+    Sio_puts(" records=");
+    Sio_putl(records);
+    Sio_puts(" lookups=");
+    Sio_putl(lookups);
+    Sio_puts(" variant_hits=");
+    Sio_putl(variants);
+    Sio_puts("\n");
+}
@@ -0,0 +1,28 @@
+/*
+ * vary.h - remembering which URIs have responses that vary by request header
+ *
+ * An origin that answers a URI with "Vary: Accept-Language" may send a
+ * different body for every value of that header, so a single entry per
+ * URI would serve one client's variant to another. The URIs whose
+ * responses carried a Vary list are recorded here with the list; a
+ * request for one of them is cached under a variant key, the URI
+ * followed by the normalised values of the listed headers (see
+ * http_variant_key()), so the variants live side by side as ordinary
+ * entries. The table is a hash of URIs, striped over a few locks;
+ * each stripe's buckets double as it fills, so every URI that varies
+ * stays known until a response without Vary forgets it.
+ */
+#ifndef __VARY_H__
+#define __VARY_H__
+
+#include "http.h"
+
+#define VARY_LOCKS 64             /* URIs are striped over this many locks */
+#define VARY_MIN_BUCKETS 16       /* Initial buckets of each stripe */
+
+void vary_init(void);
+int vary_lookup(const char *uri, unsigned long hash, char *names);
+void vary_record(const char *uri, unsigned long hash, const char *names);
+void vary_print_stats(void);
+
+#endif /* __VARY_H__ */